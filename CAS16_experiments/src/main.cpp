@@ -7,12 +7,19 @@
 #include <numeric>
 #include <thread>
 
+#include "CacheAligned.h"
+#include "StartSkew.h"
+#include "TscClock.h"
+
 #ifndef PARAM_N_THREADS
 #define PARAM_N_THREADS 24
 #endif
 #ifndef PARAM_CAS2_IMPL
 #define PARAM_CAS2_IMPL LibAtomic
 #endif
+#ifndef PARAM_START_MODE
+#define PARAM_START_MODE Barrier
+#endif
 
 namespace {
     auto consteval Pow(std::size_t base, std::size_t exp) -> std::size_t { return exp == 0 ? 1 : base * Pow(base, exp - 1); }
@@ -24,17 +31,18 @@ namespace {
         LibAtomic,
     };
     constexpr CAS2Impl CAS2_IMPL = CAS2Impl::PARAM_CAS2_IMPL;
+    enum class StartMode {
+        Barrier,     // tid 0 takes begin when it leaves the start barrier
+        Deadline,    // every thread spins to an absolute start time set by the start barrier, begin is the deadline
+    };
+    constexpr StartMode START_MODE = StartMode::PARAM_START_MODE;
     constexpr std::memory_order Order = std::memory_order_relaxed;
     constexpr std::size_t N_THREADS = PARAM_N_THREADS;
     constexpr std::size_t LOG2N_OPS = 25;
     constexpr std::size_t NOps = Pow(2, LOG2N_OPS);
     constexpr std::size_t ThreadOps = NOps / N_THREADS;
 
-#ifdef __cpp_lib_hardware_interference_size
-    constexpr std::size_t CACHE_LINE_SIZE = std::hardware_constructive_interference_size;
-#else
-    constexpr std::size_t CACHE_LINE_SIZE = 64;
-#endif
+    constexpr std::size_t CACHE_LINE_SIZE = Cache::FALSE_SHARING_SIZE;
 
     auto PinThisThreadToCore(std::size_t core) -> void {
         int err{};
@@ -126,20 +134,31 @@ namespace {
     }
 
     auto Benchmark() -> void {
-        using Clock = std::chrono::steady_clock;
+        using Clock = TscClock;
         using Unit = std::chrono::milliseconds;
         using TimePoint = Clock::time_point;
         std::array<std::thread, N_THREADS> threads{};
         TimePoint begin{};
         TimePoint end{};
         std::barrier clockBarrier{ N_THREADS };
+        TimePoint deadline{};
+        std::barrier startBarrier{ N_THREADS, [&deadline]() noexcept { deadline = StartSkew::Deadline(); } };
+        StartSkew::Recorder wakes{ N_THREADS };
 
         for (auto tid = 0UL; tid < threads.size(); ++tid) {
-            threads.at(tid) = std::thread([tid, &begin, &end, &clockBarrier]() {
+            threads.at(tid) = std::thread([tid, &begin, &end, &clockBarrier, &deadline, &startBarrier, &wakes]() {
                 PinThisThreadToCore(tid % N_THREADS);
-                clockBarrier.arrive_and_wait();
                 Type expected{ 0 };
-                if (tid == 0) begin = Clock::now();
+                if constexpr (START_MODE == StartMode::Deadline) {
+                    startBarrier.arrive_and_wait();
+                    StartSkew::SpinUntil(deadline);
+                    wakes.Record(tid);
+                    if (tid == 0) begin = deadline;
+                } else {
+                    clockBarrier.arrive_and_wait();
+                    wakes.Record(tid);
+                    if (tid == 0) begin = Clock::now();
+                }
                 auto i = 0ULL;
                 while (i < ThreadOps) {
                     Type desired = expected + Type{ 1 };
@@ -153,8 +172,13 @@ namespace {
             });
         }
         for (auto& t : threads) t.join();
+        // Lines after the first two are for reading, RunAll.py parses duration and operations only
+        const StartSkew::Summary skew = wakes.Summarize();
+        const auto durationNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
         std::cout << std::chrono::duration_cast<Unit>(end - begin).count() << "\n"
-                  << NOps << "\n";
+                  << NOps << "\n"
+                  << "wake skew: max " << skew.maxLateNs << " ns, mean " << skew.meanLateNs << " ns, spread " << skew.spreadNs << " ns, max "
+                  << 100.0 * skew.maxLateNs / durationNs << "% of the run\n";
     }
 }    // namespace
 
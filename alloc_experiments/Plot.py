@@ -23,6 +23,7 @@ PALETTE_ORDER = [
     'pmemobj_alloc',
     'make_persistent_atomic',
     'pmem',
+    'pmem_atomic',
 ]
 
 TRACE_FILES = [
@@ -16,6 +16,7 @@ BENCHES = [
     './build/bench_pmemobj_alloc',
     './build/bench_make_persistent_atomic',
     './build/bench_pmem',
+    './build/bench_pmem_atomic',
 ]
 
 OPERATIONS = [
@@ -65,7 +66,7 @@ def run_repeatedly(args):
     my_env = {}
     if args[0] == './build/bench_vmmalloc':
         my_env = os.environ.copy()
-        my_env['VMMALLOC_POOL_DIR'] = '/mnt/pmem0/myrontsa'
+        my_env['VMMALLOC_POOL_DIR'] = os.environ.get('PMEM_POOL_ROOT', '/mnt/pmem0/myrontsa')
         my_env['VMMALLOC_POOL_SIZE'] = f'{1024 *1024*1024*32}'  # 32GB
 
     def get_duration_avg():
@@ -107,8 +108,6 @@ def main():
         with open(f'{op[0]}_{op[1]}.csv', 'w') as f:
             f.write(f'allocator,threads,{UNIT},operations\n')
             for bench in BENCHES:
-                if op[1] == 'Alloc' and bench == './build/bench_pmem':
-                    continue  # do not run Alloc operation with bench_pmem, it is erroneous
                 for n in N_THREADS:
                     allocator, threads, duration, operations = run_repeatedly(
                         [bench, n, op[0], op[1]])
@@ -1,5 +1,8 @@
 #include "interface.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <filesystem>
 #include <iostream>
 #include <stdexcept>
@@ -21,6 +24,9 @@
 
 #include <libpmem.h>
 
+#include "CacheAligned.h"
+#include "Prefault.h"
+
 namespace Default {
     [[maybe_unused]] auto InitPool() -> void {}
     [[maybe_unused]] auto DestroyPool() -> void {}
@@ -146,31 +152,55 @@ namespace MakePersistentAtomic {
 
 namespace Pmem {
     const std::string PoolPath = std::string{ Config::NVM_DIR } + "/pmem";
+    constexpr std::size_t CHUNK_SIZE = 1024ULL * 1024ULL;    //1MB, one fetch_add per 8192 allocs of 128B
     char* PmemAddr{};
     std::size_t MappedLen{};
-    char* AllocIdx{};
+    CacheAligned<std::atomic<std::size_t>> Cursor{};    // Offset of the next free byte, on its own line away from PmemAddr and MappedLen that every alloc reads
+    thread_local char* ChunkIdx{};
+    thread_local char* ChunkEnd{};
     [[maybe_unused]] auto InitPool() -> void {
         int isPmem;
         PmemAddr = static_cast<char*>(pmem_map_file(PoolPath.data(), Config::POOL_SIZE, PMEM_FILE_CREATE, 0666, &MappedLen, &isPmem));
         if (!PmemAddr) throw std::runtime_error{ "pmem_map_file" };
-        if (!isPmem) throw std::runtime_error{ "pmem_map_file" };
-        AllocIdx = PmemAddr;
+        if (!isPmem && !PmemEmu::Enabled()) throw std::runtime_error{ "pmem_map_file: not pmem, set PMEM_EMULATE=1 to run on tmpfs" };
+        Cursor.data.store(0, std::memory_order_relaxed);
+        // Fault the front of the pool in on the socket of the benchmark threads, else the first alloc of every page faults inside the timed loop
+        const std::size_t prefaultLen = std::min(MappedLen, Config::PREFAULT_SIZE);
+        Prefault::Run({ reinterpret_cast<std::byte*>(PmemAddr), prefaultLen }, Prefault::SocketCpus(0));
     }
     [[maybe_unused]] auto DestroyPool() -> void {
         [[maybe_unused]] int err = pmem_unmap(PmemAddr, MappedLen);
         if (err) throw std::runtime_error{ "pmem_unmap" };
         err = std::system(("rm " + PoolPath).data());
         if (err) throw std::system_error{ std::error_code(err, std::system_category()) };
-        AllocIdx = nullptr;
+        ChunkIdx = ChunkEnd = nullptr;    // Chunks of the benchmark threads died with them, only the caller's is left
+    }
+    // One fetch_add on the shared cursor, relaxed since the pool is mapped before any thread starts and nothing is published through it
+    auto Reserve(std::size_t sz) -> char* {
+        const std::size_t offset = Cursor.data.fetch_add(sz, std::memory_order_relaxed);
+        if (MappedLen < offset + sz) throw std::bad_alloc{};
+        return PmemAddr + offset;
     }
+    // Per-thread bump inside a chunk, the shared cursor is only touched to refill, the rest of a chunk that cannot fit sz is dropped
     [[maybe_unused]] auto Alloc(std::size_t sz) -> void* {
-        if (PmemAddr + MappedLen <= AllocIdx + sz) throw std::bad_alloc{};
-        void* ptr = AllocIdx;
-        AllocIdx += sz;
+        if (CHUNK_SIZE < sz) return Reserve(sz);
+        if (static_cast<std::size_t>(ChunkEnd - ChunkIdx) < sz) {
+            ChunkIdx = Reserve(CHUNK_SIZE);
+            ChunkEnd = ChunkIdx + CHUNK_SIZE;
+        }
+        void* ptr = ChunkIdx;
+        ChunkIdx += sz;
         return ptr;
     }
 }    // namespace Pmem
 
+namespace PmemAtomic {
+    [[maybe_unused]] auto InitPool() -> void { Pmem::InitPool(); }
+    [[maybe_unused]] auto DestroyPool() -> void { Pmem::DestroyPool(); }
+    // Every alloc hits the shared cursor, the contention baseline for Pmem::Alloc
+    [[maybe_unused]] auto Alloc(std::size_t sz) -> void* { return Pmem::Reserve(sz); }
+}    // namespace PmemAtomic
+
 namespace Interface {
 #ifdef BENCH_DEFAULT
     auto InitPool() -> void { Default::InitPool(); }
@@ -217,4 +247,9 @@ namespace Interface {
     auto DestroyPool() -> void { Pmem::DestroyPool(); }
     auto Alloc(std::size_t sz) -> void* { return Pmem::Alloc(sz); }
 #endif
+#ifdef BENCH_PMEM_ATOMIC
+    auto InitPool() -> void { PmemAtomic::InitPool(); }
+    auto DestroyPool() -> void { PmemAtomic::DestroyPool(); }
+    auto Alloc(std::size_t sz) -> void* { return PmemAtomic::Alloc(sz); }
+#endif
 }    // namespace Interface
@@ -3,8 +3,12 @@
 
 #include <chrono>
 #include <cstdint>
+#include <string>
 #include <string_view>
 
+#include "PmemEmu.h"
+#include "TscClock.h"
+
 namespace Interface {
     auto InitPool() -> void;
     auto DestroyPool() -> void;
@@ -14,10 +18,11 @@ namespace Interface {
 namespace Config {
     constexpr inline std::size_t POOL_SIZE = 1024ULL * 1024ULL * 1024ULL * 32;    //32GB
     constexpr inline std::size_t ALLOC_SIZE = 128;
-    constexpr inline std::string_view NVM_DIR = "/mnt/pmem0/myrontsa/alloc_experiments_pools";
+    constexpr inline std::size_t PREFAULT_SIZE = 1024ULL * 1024ULL * 1024ULL * 4;    //4GB, past what one Benchmark() allocates, the rest of the pool faults lazily
+    inline const std::string NVM_DIR = PmemEmu::PoolPath("alloc_experiments_pools");    // Under PMEM_POOL_ROOT
 }    // namespace Config
 
-using Clock = std::chrono::steady_clock;
+using Clock = TscClock;
 using Millis = std::chrono::milliseconds;
 using Micros = std::chrono::microseconds;
 struct Type {
@@ -1,14 +1,18 @@
 #include <cassert>
 #include <cstring>
 #include <iostream>
+#include <memory>
+#include <new>
 #include <random>
 #include <ratio>
+#include <span>
 #include <string>
 #include <thread>
 #include <vector>
 
 #include <libpmem.h>
 
+#include "CacheAligned.h"
 #include "interface.h"
 
 namespace {
@@ -113,53 +117,87 @@ namespace {
             dummy = dummy;
     }
 
-    auto Operation(std::vector<Type*>& vec, std::size_t idx) -> void {
-        switch (BenchOp) {
-            case BenchOpType::Alloc: vec.at(idx) = static_cast<Type*>(Interface::Alloc(TypeSize)); break;
-            case BenchOpType::Read: (void)*(vec.at(idx)); break;
-            case BenchOpType::Write: *(vec.at(idx)) = Type{}; break;
-            default: throw std::logic_error{ "BenchOp default case" };
+    template<typename T> auto DoNotOptimize(const T& val) -> void { asm volatile("" : : "r,m"(val) : "memory"); }
+
+    // One thread's results, its own allocation aligned and padded to whole cache lines so no two threads write a shared line
+    class Slab {
+    public:
+        explicit Slab(std::size_t slabOps)
+            : ops{ slabOps }, slots{ new (std::align_val_t{ Cache::FALSE_SHARING_SIZE }) Type*[RoundUpToLine(slabOps)]{} } {}
+        auto Span() const -> std::span<Type*> { return { slots.get(), ops }; }
+
+    private:
+        static constexpr std::size_t SLOTS_PER_LINE = Cache::FALSE_SHARING_SIZE / sizeof(Type*);
+        static auto RoundUpToLine(std::size_t n) -> std::size_t { return (n + SLOTS_PER_LINE - 1) / SLOTS_PER_LINE * SLOTS_PER_LINE; }
+        struct FreeAligned {
+            auto operator()(Type** ptr) const -> void { ::operator delete[](ptr, std::align_val_t{ Cache::FALSE_SHARING_SIZE }); }
+        };
+        std::size_t ops{};
+        std::unique_ptr<Type*[], FreeAligned> slots{};
+    };
+
+    // The op is a template parameter, the loop carries no switch and no bounds check
+    template<BenchOpType OP> auto Operation(std::span<Type*> slab) -> void {
+        for (auto& slot : slab) {
+            if constexpr (OP == BenchOpType::Alloc) slot = static_cast<Type*>(Interface::Alloc(TypeSize));
+            if constexpr (OP == BenchOpType::Read) {
+                char acc{};    // One load per cache line of the object, a bare (void)*slot is dropped by the compiler
+                for (auto i = 0UL; i < TypeSize; i += Cache::FALSE_SHARING_SIZE) acc ^= slot->data[i];
+                DoNotOptimize(acc);
+            }
+            if constexpr (OP == BenchOpType::Write) *slot = Type{};
+            // RandomWork();
+        }
+    }
+    template<BenchOpType OP> auto RunThreads(std::vector<Slab>& slabs) -> void {
+        std::vector<std::thread> threads(slabs.size());
+        for (auto tid = 0u; tid < threads.size(); ++tid) {
+            threads.at(tid) = std::thread([slab = slabs.at(tid).Span(), tid]() {
+                PinThisThreadToCore(tid % NThreads);
+                Operation<OP>(slab);
+            });
         }
+        for (auto& t : threads) t.join();
     }
 
     auto Benchmark() -> void {
-        std::size_t threadOps = Nops / NThreads;
-        std::vector<Type*> allocs(Nops);
-        std::vector<std::thread> threads(NThreads);
-        // std::cout << "allocs capacity byte size: " << allocs.capacity() * sizeof(void*) << "\n";
+        const std::size_t threadOps = Nops / NThreads;
+        const std::size_t ops = threadOps * NThreads;    // The remainder of Nops is not run, nor counted
+        std::vector<Slab> slabs{};
+        for (auto tid = 0u; tid < NThreads; ++tid) slabs.emplace_back(threadOps);
         if (AllocOp == AllocOpType::Block) {
-            Type* block = static_cast<Type*>(Interface::Alloc(Nops * TypeSize));
-            for (auto i = 0u; i < allocs.size(); ++i) allocs.at(i) = block + i;
+            Type* block = static_cast<Type*>(Interface::Alloc(ops * TypeSize));
+            for (const auto& slab : slabs)
+                for (auto& slot : slab.Span()) slot = block++;
         }
         if (AllocOp == AllocOpType::Sparse) {
-            for (auto& ptr : allocs) ptr = static_cast<Type*>(Interface::Alloc(TypeSize));
+            for (const auto& slab : slabs)
+                for (auto& slot : slab.Span()) slot = static_cast<Type*>(Interface::Alloc(TypeSize));
         }
         const auto begin = Clock::now();
-        for (auto tid = 0u; tid < threads.size(); ++tid) {
-            const auto threadBegin = tid * threadOps;
-            const auto threadEnd = threadBegin + threadOps;
-            threads.at(tid) = std::thread([&allocs, tid, threadBegin, threadEnd]() {
-                PinThisThreadToCore(tid % NThreads);
-                for (auto i = threadBegin; i < threadEnd; ++i) {
-                    Operation(allocs, i);
-                    // RandomWork();
-                }
-            });
+        switch (BenchOp) {
+            case BenchOpType::Alloc: RunThreads<BenchOpType::Alloc>(slabs); break;
+            case BenchOpType::Read: RunThreads<BenchOpType::Read>(slabs); break;
+            case BenchOpType::Write: RunThreads<BenchOpType::Write>(slabs); break;
+            default: throw std::logic_error{ "BenchOp default case" };
         }
-        for (auto& t : threads) t.join();
         const auto end = Clock::now();
         std::cout << std::chrono::duration_cast<Micros>(end - begin).count() << "\n"
-                  << Nops << "\n";
+                  << ops << "\n";
     }
 }    // namespace
 
 auto main(int argc, char* argv[]) -> int {
+    PmemEmu::Init();
     ParseArgs(argc, argv);
     // std::cout << "Persistent Memory Support: " << IsPmem() << "\n";
     [[maybe_unused]] int err = std::system(("mkdir -p " + std::string{ Config::NVM_DIR }).data());
     if (err) throw std::system_error{ std::error_code(err, std::system_category()) };
 
+    const auto initBegin = Clock::now();
     Interface::InitPool();
+    const auto initEnd = Clock::now();
     Benchmark();
+    std::cout << std::chrono::duration_cast<Micros>(initEnd - initBegin).count() << "\n";    // After the two lines RunAll.py reads
     Interface::DestroyPool();
 }
@@ -0,0 +1,128 @@
+#include "Barrier.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <climits>
+#include <thread>
+
+#include <immintrin.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+    constexpr std::size_t SPIN_ITERATIONS = 1 << 12;
+
+    auto Rounds(std::size_t threads) -> std::size_t { return std::bit_width(threads - 1); }
+    // Pause, then yield once the wait outlasts a few microseconds, so oversubscribed teams still progress
+    auto SpinUntil(auto&& ready) -> void {
+        for (auto i = 0UL; !ready(); ++i) {
+            if (i < SPIN_ITERATIONS) _mm_pause();
+            else std::this_thread::yield();
+        }
+    }
+}    // namespace
+
+namespace Barrier {
+
+    SenseReversing::SenseReversing(std::size_t _threads)
+        : threads{ _threads }, localSenses{ std::make_unique<LocalSense[]>(_threads) } {}
+    auto SenseReversing::ArriveAndWait(std::size_t tid) -> void {
+        const bool mySense = localSenses[tid].sense = !localSenses[tid].sense;
+        if (count.fetch_add(1, std::memory_order_acq_rel) + 1 == threads) {
+            count.store(0, std::memory_order_relaxed);
+            sense.store(mySense, std::memory_order_release);
+            return;
+        }
+        SpinUntil([&]() { return sense.load(std::memory_order_acquire) == mySense; });
+    }
+
+    Dissemination::Dissemination(std::size_t _threads)
+        : threads{ _threads }, rounds{ Rounds(_threads) }, flags{ std::make_unique<Flags[]>(_threads) } {
+        assert(rounds <= MAX_ROUNDS);
+    }
+    // Signals are counted, not flipped, so a partner already in the next episode cannot erase the current one
+    auto Dissemination::ArriveAndWait(std::size_t tid) -> void {
+        const std::uint64_t episode = ++flags[tid].episode;
+        for (auto k = 0UL; k < rounds; ++k) {
+            const std::size_t partner = (tid + (1UL << k)) % threads;
+            flags[partner].rounds[k].fetch_add(1, std::memory_order_release);
+            SpinUntil([&]() { return flags[tid].rounds[k].load(std::memory_order_acquire) >= episode; });
+        }
+    }
+
+    Tournament::Tournament(std::size_t _threads)
+        : threads{ _threads }, rounds{ Rounds(_threads) }, flags{ std::make_unique<Flags[]>(_threads) } {
+        assert(rounds <= MAX_ROUNDS);
+    }
+    auto Tournament::ArriveAndWait(std::size_t tid) -> void {
+        const std::uint64_t episode = ++flags[tid].episode;
+        for (auto k = 0UL; k < rounds; ++k) {
+            const std::size_t stride = 1UL << k;
+            if ((tid & stride) != 0) {
+                // Loser, reports to the winner of the pair and waits for the champion
+                flags[tid - stride].arrived[k].store(episode, std::memory_order_release);
+                SpinUntil([&]() { return release.load(std::memory_order_acquire) >= episode; });
+                return;
+            }
+            if (tid + stride < threads) SpinUntil([&]() { return flags[tid].arrived[k].load(std::memory_order_acquire) >= episode; });
+        }
+        release.store(episode, std::memory_order_release);    // Only thread 0 wins every round
+    }
+
+    CombiningTree::CombiningTree(std::size_t _threads)
+        : episodes{ std::make_unique<LocalEpisode[]>(_threads) } {
+        std::size_t total = 0;
+        for (std::size_t width = _threads; width > 1 || total == 0; width = (width + FAN_IN - 1) / FAN_IN) total += (width + FAN_IN - 1) / FAN_IN;
+        nodes = std::vector<Node>(total);    // Atomics do not move, sized once
+        // Levels are laid out leaves first, node i of a level has parent i / FAN_IN on the next, the root has parent nodes.size()
+        std::size_t first = 0;
+        for (std::size_t width = _threads; first < total; width = (width + FAN_IN - 1) / FAN_IN) {
+            const std::size_t levelNodes = (width + FAN_IN - 1) / FAN_IN;
+            const std::size_t next = first + levelNodes;
+            for (auto i = 0UL; i < levelNodes; ++i) {
+                nodes[first + i].expected = std::min(FAN_IN, width - i * FAN_IN);
+                nodes[first + i].parent = next == total ? total : next + i / FAN_IN;
+            }
+            first = next;
+        }
+    }
+    // Counters are reset by the last arriver, no thread reaches the node again before the release
+    auto CombiningTree::ArriveAndWait(std::size_t tid) -> void {
+        const std::uint64_t episode = ++episodes[tid].episode;
+        std::size_t index = tid / FAN_IN;
+        while (index < nodes.size()) {
+            auto& node = nodes[index];
+            if (node.count.fetch_add(1, std::memory_order_acq_rel) + 1 != node.expected) {
+                SpinUntil([&]() { return release.load(std::memory_order_acquire) >= episode; });
+                return;
+            }
+            node.count.store(0, std::memory_order_relaxed);
+            index = node.parent;
+        }
+        release.store(episode, std::memory_order_release);
+    }
+
+    Futex::Futex(std::size_t _threads)
+        : threads{ _threads } {}
+    // The wake syscall is only paid when a waiter outlasted its spin
+    auto Futex::ArriveAndWait([[maybe_unused]] std::size_t tid) -> void {
+        const std::uint32_t current = generation.load(std::memory_order_acquire);
+        if (count.fetch_add(1, std::memory_order_acq_rel) + 1 == threads) {
+            count.store(0, std::memory_order_relaxed);
+            generation.store(current + 1, std::memory_order_seq_cst);
+            if (sleepers.load(std::memory_order_seq_cst) != 0)
+                syscall(SYS_futex, std::bit_cast<std::uint32_t*>(&generation), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+            return;
+        }
+        for (auto i = 0UL; i < SPIN_ITERATIONS; ++i) {
+            if (generation.load(std::memory_order_acquire) != current) return;
+            _mm_pause();
+        }
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        while (generation.load(std::memory_order_seq_cst) == current)
+            syscall(SYS_futex, std::bit_cast<std::uint32_t*>(&generation), FUTEX_WAIT_PRIVATE, current, nullptr, nullptr, 0);
+        sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+}    // namespace Barrier
@@ -0,0 +1,101 @@
+#ifndef BARRIER_H
+#define BARRIER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "CacheAligned.h"
+
+// Reusable barriers for a fixed team of threads, alternatives to std::barrier. Threads pass their team index 0..threads-1
+namespace Barrier {
+    constexpr std::size_t CACHE_LINE_SIZE = Cache::FALSE_SHARING_SIZE;
+    constexpr std::size_t MAX_ROUNDS = 7;    // Pairwise rounds for up to 128 threads
+
+    // One counter, the last arriver flips the global sense every thread spins on
+    class SenseReversing {
+    public:
+        explicit SenseReversing(std::size_t _threads);
+        auto ArriveAndWait(std::size_t tid) -> void;
+
+    private:
+        struct alignas(CACHE_LINE_SIZE) LocalSense {
+            bool sense{};
+        };
+        std::size_t threads{};
+        alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> count{};
+        alignas(CACHE_LINE_SIZE) std::atomic<bool> sense{};
+        std::unique_ptr<LocalSense[]> localSenses{};
+    };
+
+    // ceil(log2(threads)) rounds, in round k thread i signals thread i + 2^k, no thread is the bottleneck
+    class Dissemination {
+    public:
+        explicit Dissemination(std::size_t _threads);
+        auto ArriveAndWait(std::size_t tid) -> void;
+
+    private:
+        struct alignas(CACHE_LINE_SIZE) Flags {
+            std::uint64_t episode{};                            // Episodes this thread completed, written by its owner only
+            std::atomic<std::uint64_t> rounds[MAX_ROUNDS]{};    // Signals received per round
+        };
+        std::size_t threads{};
+        std::size_t rounds{};
+        std::unique_ptr<Flags[]> flags{};
+    };
+
+    // Statically paired rounds, the winner of each pair climbs, thread 0 wins the tournament and releases everyone
+    class Tournament {
+    public:
+        explicit Tournament(std::size_t _threads);
+        auto ArriveAndWait(std::size_t tid) -> void;
+
+    private:
+        struct alignas(CACHE_LINE_SIZE) Flags {
+            std::uint64_t episode{};
+            std::atomic<std::uint64_t> arrived[MAX_ROUNDS]{};    // Episode the loser of each round last arrived for
+        };
+        std::size_t threads{};
+        std::size_t rounds{};
+        std::unique_ptr<Flags[]> flags{};
+        alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> release{};
+    };
+
+    // Counters of FAN_IN threads each, the last arriver of a node climbs to its parent, the last at the root releases everyone
+    class CombiningTree {
+    public:
+        static constexpr std::size_t FAN_IN = 4;
+        explicit CombiningTree(std::size_t _threads);
+        auto ArriveAndWait(std::size_t tid) -> void;
+
+    private:
+        struct alignas(CACHE_LINE_SIZE) Node {
+            std::atomic<std::size_t> count{};
+            std::size_t expected{};
+            std::size_t parent{};    // Index into nodes, nodes.size() at the root
+        };
+        struct alignas(CACHE_LINE_SIZE) LocalEpisode {
+            std::uint64_t episode{};
+        };
+        std::vector<Node> nodes{};
+        std::unique_ptr<LocalEpisode[]> episodes{};
+        alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> release{};
+    };
+
+    // Central counter, waiters spin briefly then sleep on a futex over the generation word, as std::barrier implementations do
+    class Futex {
+    public:
+        explicit Futex(std::size_t _threads);
+        auto ArriveAndWait(std::size_t tid) -> void;
+
+    private:
+        std::size_t threads{};
+        alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> count{};
+        alignas(CACHE_LINE_SIZE) std::atomic<std::uint32_t> generation{};
+        std::atomic<std::size_t> sleepers{};
+    };
+}    // namespace Barrier
+
+#endif
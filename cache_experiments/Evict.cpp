@@ -0,0 +1,128 @@
+#include "Evict.h"
+
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <stdexcept>
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+namespace {
+    constexpr std::size_t CACHE_LINE_SIZE = 64;
+    constexpr std::size_t MAX_SWEEP_FACTOR = 8;       // Sweep capacity as a multiple of the summed data caches
+    constexpr std::size_t CALIBRATION_ROUNDS = 3;
+    constexpr double CALIBRATION_TOLERANCE = 0.9;    // Sweep is effective once re-reads reach 90% of the flushed latency
+
+    template<typename T> auto DoNotOptimize(const T& val) -> void { asm volatile("" : : "r,m"(val) : "memory"); }
+
+    auto ReadLine(const std::filesystem::path& path) -> std::string {
+        std::ifstream f{ path };
+        std::string line{};
+        std::getline(f, line);
+        return line;
+    }
+    // sysfs sizes look like "48K" or "36864K"
+    auto ParseSysfsSize(const std::string& str) -> std::size_t {
+        std::size_t pos{};
+        const std::size_t size = std::stoul(str, &pos);
+        if (pos < str.size() && str[pos] == 'K') return size * 1024;
+        if (pos < str.size() && str[pos] == 'M') return size * 1024 * 1024;
+        return size;
+    }
+    auto HasClflushopt() -> bool {
+        unsigned eax{}, ebx{}, ecx{}, edx{};
+        if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) == 0) return false;
+        return (ebx & bit_CLFLUSHOPT) != 0;
+    }
+    const bool Clflushopt = HasClflushopt();
+
+    auto LineBegin(std::span<const std::byte> range) -> std::uintptr_t { return std::bit_cast<std::uintptr_t>(range.data()) & ~(CACHE_LINE_SIZE - 1); }
+    auto RangeEnd(std::span<const std::byte> range) -> std::uintptr_t { return std::bit_cast<std::uintptr_t>(range.data() + range.size()); }
+
+    // clflushopt is weakly ordered, sfence orders it against later accesses
+    __attribute__((target("clflushopt"))) auto FlushOpt(std::span<const std::byte> range) -> void {
+        for (auto line = LineBegin(range); line < RangeEnd(range); line += CACHE_LINE_SIZE) _mm_clflushopt(std::bit_cast<void*>(line));
+        _mm_sfence();
+    }
+    auto FlushLegacy(std::span<const std::byte> range) -> void {
+        for (auto line = LineBegin(range); line < RangeEnd(range); line += CACHE_LINE_SIZE) _mm_clflush(std::bit_cast<const void*>(line));
+        _mm_mfence();
+    }
+    auto TouchLines(std::span<const std::byte> range) -> void {
+        std::uint64_t acc{};
+        for (auto i = 0UL; i + sizeof(acc) <= range.size(); i += CACHE_LINE_SIZE) {
+            std::uint64_t word{};
+            std::memcpy(&word, &range[i], sizeof(word));
+            acc ^= word;
+        }
+        DoNotOptimize(acc);
+    }
+}    // namespace
+
+namespace Evict {
+    auto ReadCacheLevels(std::size_t cpu) -> std::vector<CacheLevel> {
+        const std::filesystem::path cacheDir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cache";
+        std::vector<CacheLevel> levels{};
+        for (auto idx = 0UL;; ++idx) {
+            const auto indexDir = cacheDir / ("index" + std::to_string(idx));
+            if (!std::filesystem::exists(indexDir)) break;
+            CacheLevel level{
+                .level = std::stoul(ReadLine(indexDir / "level")),
+                .type = ReadLine(indexDir / "type"),
+                .size = ParseSysfsSize(ReadLine(indexDir / "size")),
+                .lineSize = std::stoul(ReadLine(indexDir / "coherency_line_size")),
+                .ways = std::stoul(ReadLine(indexDir / "ways_of_associativity")),
+            };
+            if (level.type != "Instruction") levels.emplace_back(std::move(level));
+        }
+        return levels;
+    }
+
+    auto FlushRange(std::span<const std::byte> range) -> void {
+        if (Clflushopt) FlushOpt(range);
+        else FlushLegacy(range);
+    }
+
+    auto TimeReRead(std::span<const std::byte> range) -> double {
+        const auto begin = std::chrono::steady_clock::now();
+        TouchLines(range);
+        const auto end = std::chrono::steady_clock::now();
+        const auto lines = static_cast<double>((range.size() + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE);
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / lines;
+    }
+
+    auto Sweeper::FreeAligned::operator()(std::byte* ptr) const -> void { ::operator delete(ptr, std::align_val_t{ CACHE_LINE_SIZE }); }
+
+    Sweeper::Sweeper() {
+        for (const auto& level : ReadCacheLevels(0)) cacheSize += level.size;
+        if (cacheSize == 0) throw std::runtime_error{ "Sweeper: no cache levels in sysfs" };
+        size = 2 * cacheSize;
+        capacity = MAX_SWEEP_FACTOR * cacheSize;
+        buffer.reset(static_cast<std::byte*>(::operator new(capacity, std::align_val_t{ CACHE_LINE_SIZE })));
+        std::memset(buffer.get(), 1, capacity);    // Fault in every page now, not during the first sweep
+    }
+
+    auto Sweeper::Sweep() const -> void { TouchLines({ buffer.get(), size }); }
+
+    auto Sweeper::Calibrate(std::span<const std::byte> target) -> std::size_t {
+        const auto average = [target](auto&& evict) {
+            double total{};
+            for (auto i = 0UL; i < CALIBRATION_ROUNDS; ++i) {
+                TouchLines(target);
+                evict();
+                total += TimeReRead(target);
+            }
+            return total / CALIBRATION_ROUNDS;
+        };
+        const double flushed = average([target]() { FlushRange(target); });
+        for (size = cacheSize; size < capacity; size *= 2)
+            if (average([this]() { Sweep(); }) >= CALIBRATION_TOLERANCE * flushed) return size;
+        size = capacity;
+        return size;
+    }
+}    // namespace Evict
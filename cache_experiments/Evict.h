@@ -0,0 +1,47 @@
+#ifndef EVICT_H
+#define EVICT_H
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+// Unprivileged cache eviction, alternative to the wbinvd kernel module
+namespace Evict {
+    struct CacheLevel {
+        std::size_t level{};
+        std::string type{};
+        std::size_t size{};
+        std::size_t lineSize{};
+        std::size_t ways{};
+    };
+    // Data and Unified caches of cpu, read from /sys/devices/system/cpu/cpu<cpu>/cache/index*
+    auto ReadCacheLevels(std::size_t cpu = 0) -> std::vector<CacheLevel>;
+
+    // clflushopt, or clflush where unsupported, on every line of range followed by a fence
+    auto FlushRange(std::span<const std::byte> range) -> void;
+    // Nanoseconds per line to load one element of every line of range
+    auto TimeReRead(std::span<const std::byte> range) -> double;
+
+    // Sweeps a private buffer through the cache hierarchy, sized as a multiple of the data caches of cpu0
+    class Sweeper {
+    public:
+        Sweeper();
+        auto Sweep() const -> void;
+        // Grows the sweep until re-reading target is as slow as after FlushRange, returns the final size
+        auto Calibrate(std::span<const std::byte> target) -> std::size_t;
+        auto Size() const -> std::size_t { return size; }
+
+    private:
+        struct FreeAligned {
+            auto operator()(std::byte* ptr) const -> void;
+        };
+        std::size_t cacheSize{};
+        std::size_t size{};
+        std::size_t capacity{};
+        std::unique_ptr<std::byte[], FreeAligned> buffer{};
+    };
+}    // namespace Evict
+
+#endif
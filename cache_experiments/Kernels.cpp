@@ -0,0 +1,123 @@
+#include "Kernels.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+    constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+    template<typename T> auto DoNotOptimize(const T& val) -> void { asm volatile("" : : "r,m"(val) : "memory"); }
+
+    auto SplitMix(std::uint64_t& state) -> std::uint64_t {
+        std::uint64_t z = (state += 0x9e3779b97f4a7c15);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+    auto XorShift(std::uint64_t x) -> std::uint64_t {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        return x;
+    }
+    // Lanes of independent xorshift64 generators, SplitMix keeps them apart and nonzero
+    template<std::size_t LANES> auto SeedLanes(std::uint64_t seed) -> std::array<std::uint64_t, LANES> {
+        std::array<std::uint64_t, LANES> lanes{};
+        for (auto& lane : lanes) lane = SplitMix(seed) | 1;
+        return lanes;
+    }
+    // The bytes of range past from, after the vector loop
+    auto StoreTail(std::span<std::byte> range, std::size_t from, std::uint64_t word) -> void {
+        for (; from < range.size(); from += sizeof(word)) std::memcpy(&range[from], &word, std::min(sizeof(word), range.size() - from));
+    }
+
+    // GCC vectors of 64-bit lanes, lowered to the registers the calling kernel's target allows, a plain uint64_t is the scalar lane
+    using Vec32 = std::uint64_t __attribute__((vector_size(32)));
+    using Vec64 = std::uint64_t __attribute__((vector_size(64)));
+
+    template<typename Vec> [[gnu::always_inline]] inline auto FillVec(std::span<std::byte> range, std::uint64_t val) -> void {
+        Vec word{};
+        word += val;
+        auto i = 0UL;
+        for (; i + sizeof(Vec) <= range.size(); i += sizeof(Vec)) std::memcpy(&range[i], &word, sizeof(Vec));
+        StoreTail(range, i, val);
+    }
+    template<typename Vec> [[gnu::always_inline]] inline auto RandomFillVec(std::span<std::byte> range, std::uint64_t seed) -> void {
+        const auto lanes = SeedLanes<sizeof(Vec) / sizeof(std::uint64_t)>(seed);
+        Vec state;
+        std::memcpy(&state, lanes.data(), sizeof(Vec));
+        auto i = 0UL;
+        for (; i + sizeof(Vec) <= range.size(); i += sizeof(Vec)) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            std::memcpy(&range[i], &state, sizeof(Vec));
+        }
+        std::uint64_t lane{};
+        std::memcpy(&lane, &state, sizeof(lane));
+        StoreTail(range, i, XorShift(lane));
+    }
+
+    auto FillScalar(std::span<std::byte> range, std::uint64_t val) -> void { FillVec<std::uint64_t>(range, val); }
+    __attribute__((target("avx2"))) auto FillAvx2(std::span<std::byte> range, std::uint64_t val) -> void { FillVec<Vec32>(range, val); }
+    __attribute__((target("avx512f"))) auto FillAvx512(std::span<std::byte> range, std::uint64_t val) -> void { FillVec<Vec64>(range, val); }
+    auto RandomFillScalar(std::span<std::byte> range, std::uint64_t seed) -> void { RandomFillVec<std::uint64_t>(range, seed); }
+    __attribute__((target("avx2"))) auto RandomFillAvx2(std::span<std::byte> range, std::uint64_t seed) -> void { RandomFillVec<Vec32>(range, seed); }
+    __attribute__((target("avx512f"))) auto RandomFillAvx512(std::span<std::byte> range, std::uint64_t seed) -> void { RandomFillVec<Vec64>(range, seed); }
+
+    auto ParseIsa(const std::string& name) -> Kernels::Isa {
+        if (name == "scalar") return Kernels::Isa::Scalar;
+        if (name == "avx2") return Kernels::Isa::Avx2;
+        if (name == "avx512") return Kernels::Isa::Avx512;
+        throw std::runtime_error{ "Kernels: KERNELS_ISA must be scalar, avx2 or avx512, not " + name };
+    }
+    auto DetectIsa() -> Kernels::Isa {
+        __builtin_cpu_init();
+        Kernels::Isa isa = Kernels::Isa::Scalar;
+        if (__builtin_cpu_supports("avx2")) isa = Kernels::Isa::Avx2;
+        if (__builtin_cpu_supports("avx512f")) isa = Kernels::Isa::Avx512;
+        if (const char* cap = std::getenv("KERNELS_ISA"); cap != nullptr) isa = std::min(isa, ParseIsa(cap));
+        return isa;
+    }
+}    // namespace
+
+namespace Kernels {
+    auto Selected() -> Isa {
+        static const Isa isa = DetectIsa();
+        return isa;
+    }
+    auto IsaName(Isa isa) -> std::string_view {
+        switch (isa) {
+            case Isa::Scalar: return "scalar";
+            case Isa::Avx2: return "avx2";
+            case Isa::Avx512: return "avx512";
+        }
+        return "unknown";
+    }
+
+    // A wider load brings in no more lines, so the warm has no vector path, it only skips the other 63 bytes of each line
+    auto WarmLines(std::span<const std::byte> range) -> void {
+        std::uint8_t acc{};
+        for (auto i = 0UL; i < range.size(); i += CACHE_LINE_SIZE) acc ^= std::to_integer<std::uint8_t>(range[i]);
+        DoNotOptimize(acc);
+    }
+    // Not memset, glibc switches to non-temporal stores past a fraction of the L3 and the cooling buffer would never reach the cache
+    auto Fill(std::span<std::byte> range, std::uint64_t val) -> void {
+        switch (Selected()) {
+            case Isa::Avx512: return FillAvx512(range, val);
+            case Isa::Avx2: return FillAvx2(range, val);
+            case Isa::Scalar: return FillScalar(range, val);
+        }
+    }
+    auto RandomFill(std::span<std::byte> range, std::uint64_t seed) -> void {
+        switch (Selected()) {
+            case Isa::Avx512: return RandomFillAvx512(range, seed);
+            case Isa::Avx2: return RandomFillAvx2(range, seed);
+            case Isa::Scalar: return RandomFillScalar(range, seed);
+        }
+    }
+}    // namespace Kernels
@@ -0,0 +1,24 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+// Cache prepare kernels, AVX-512 / AVX2 / scalar picked once at startup from what the cpu supports
+namespace Kernels {
+    enum class Isa { Scalar, Avx2, Avx512 };
+    // Widest supported, KERNELS_ISA=scalar|avx2|avx512 caps it to compare the paths
+    auto Selected() -> Isa;
+    auto IsaName(Isa isa) -> std::string_view;
+
+    // One load per cache line of range
+    auto WarmLines(std::span<const std::byte> range) -> void;
+    // Full-line stores of val, each line is allocated in the cache like the byte loop did
+    auto Fill(std::span<std::byte> range, std::uint64_t val) -> void;
+    // xorshift64 lanes seeded from seed, one vector of random bytes per store
+    auto RandomFill(std::span<std::byte> range, std::uint64_t seed) -> void;
+}    // namespace Kernels
+
+#endif
@@ -0,0 +1,69 @@
+#include "Topology.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+#include <unistd.h>
+
+namespace {
+    auto ReadNumber(const std::filesystem::path& path) -> std::size_t {
+        std::ifstream f{ path };
+        std::size_t num{};
+        if (!(f >> num)) throw std::runtime_error{ "Topology: cannot read " + path.string() };
+        return num;
+    }
+    auto FindCpu(const std::vector<Topology::Cpu>& cpus, std::size_t cpu) -> const Topology::Cpu& {
+        const auto it = std::ranges::find(cpus, cpu, &Topology::Cpu::id);
+        if (it == cpus.end()) throw std::runtime_error{ "Topology: cpu " + std::to_string(cpu) + " offline" };
+        return *it;
+    }
+    // Position of cpu among the SMT siblings of its core, 0 for the first hardware thread
+    auto SmtIndex(const std::vector<Topology::Cpu>& cpus, const Topology::Cpu& cpu) -> std::size_t {
+        return static_cast<std::size_t>(
+            std::ranges::count_if(cpus, [&cpu](const auto& other) { return other.package == cpu.package && other.core == cpu.core && other.id < cpu.id; }));
+    }
+}    // namespace
+
+namespace Topology {
+    auto ReadCpus() -> std::vector<Cpu> {
+        const auto configured = static_cast<std::size_t>(sysconf(_SC_NPROCESSORS_CONF));
+        std::vector<Cpu> cpus{};
+        for (auto id = 0UL; id < configured; ++id) {
+            const std::filesystem::path cpuDir = "/sys/devices/system/cpu/cpu" + std::to_string(id);
+            // cpu0 has no online file, it cannot be offlined
+            if (std::filesystem::exists(cpuDir / "online") && ReadNumber(cpuDir / "online") == 0) continue;
+            cpus.push_back({ .id = id, .core = ReadNumber(cpuDir / "topology/core_id"), .package = ReadNumber(cpuDir / "topology/physical_package_id") });
+        }
+        return cpus;
+    }
+
+    auto PickPeer(const std::vector<Cpu>& cpus, std::size_t cpu, Placement placement) -> std::optional<std::size_t> {
+        const Cpu& self = FindCpu(cpus, cpu);
+        const auto matches = [&self, placement](const Cpu& other) {
+            switch (placement) {
+                case Placement::SameCore: return other.id == self.id;
+                case Placement::SmtSibling: return other.id != self.id && other.package == self.package && other.core == self.core;
+                case Placement::SameSocket: return other.package == self.package && other.core != self.core;
+                case Placement::RemoteSocket: return other.package != self.package;
+            }
+            return false;
+        };
+        const auto it = std::ranges::find_if(cpus, matches);
+        if (it == cpus.end()) return std::nullopt;
+        return it->id;
+    }
+
+    auto SpreadOrder(const std::vector<Cpu>& cpus, std::size_t cpu) -> std::vector<std::size_t> {
+        const Cpu& self = FindCpu(cpus, cpu);
+        std::vector<Cpu> sorted = cpus;
+        const auto key = [&cpus, &self](const Cpu& c) { return std::tuple{ c.package != self.package, SmtIndex(cpus, c), c.package, c.core, c.id }; };
+        std::ranges::sort(sorted, [&key](const Cpu& lhs, const Cpu& rhs) { return key(lhs) < key(rhs); });
+        std::vector<std::size_t> order{};
+        for (const auto& c : sorted) order.push_back(c.id);
+        return order;
+    }
+}    // namespace Topology
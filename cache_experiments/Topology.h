@@ -0,0 +1,25 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+// CPU placement from /sys/devices/system/cpu/cpu*/topology
+namespace Topology {
+    struct Cpu {
+        std::size_t id{};
+        std::size_t core{};       // core_id, shared by SMT siblings
+        std::size_t package{};    // physical_package_id, the socket
+    };
+    enum class Placement { SameCore, SmtSibling, SameSocket, RemoteSocket };
+
+    // Online cpus ordered by id
+    auto ReadCpus() -> std::vector<Cpu>;
+    // A cpu placed relative to cpu, nullopt when the machine has none, e.g. no SMT or a single socket
+    auto PickPeer(const std::vector<Cpu>& cpus, std::size_t cpu, Placement placement) -> std::optional<std::size_t>;
+    // Cpus ordered to spread work starting from cpu: its socket before remote ones, one thread per physical core before SMT siblings
+    auto SpreadOrder(const std::vector<Cpu>& cpus, std::size_t cpu) -> std::vector<std::size_t>;
+}    // namespace Topology
+
+#endif
@@ -0,0 +1,76 @@
+#include "Worker.h"
+
+#include <bit>
+#include <cassert>
+
+#include <immintrin.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+    constexpr std::uint32_t SLEEPING = 1U << 31;        // Set by a waiter about to sleep, tells Store to wake it
+    constexpr std::size_t SPIN_ITERATIONS = 1 << 12;    // A few microseconds of pause before the futex
+
+    auto FutexWait(std::atomic<std::uint32_t>& word, std::uint32_t val) -> void {
+        syscall(SYS_futex, std::bit_cast<std::uint32_t*>(&word), FUTEX_WAIT_PRIVATE, val, nullptr, nullptr, 0);
+    }
+    auto FutexWake(std::atomic<std::uint32_t>& word) -> void { syscall(SYS_futex, std::bit_cast<std::uint32_t*>(&word), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0); }
+
+    auto PinThisThreadToCore(std::size_t core) -> void {
+        assert(core < std::jthread::hardware_concurrency());
+        cpu_set_t cpu_mask;
+        CPU_ZERO(&cpu_mask);
+        CPU_SET(core, &cpu_mask);
+        [[maybe_unused]] const int err = pthread_setaffinity_np(pthread_self(), sizeof(cpu_mask), &cpu_mask);
+        assert(err == 0);
+    }
+}    // namespace
+
+namespace Worker {
+    auto WaitWhile(std::atomic<std::uint32_t>& word, std::uint32_t val) -> void {
+        for (auto i = 0UL; i < SPIN_ITERATIONS; ++i) {
+            if ((word.load(std::memory_order_acquire) & ~SLEEPING) != val) return;
+            _mm_pause();
+        }
+        for (;;) {
+            std::uint32_t expected = val;
+            if (!word.compare_exchange_strong(expected, val | SLEEPING, std::memory_order_acquire) && (expected & ~SLEEPING) != val) return;
+            FutexWait(word, val | SLEEPING);    // Returns at once if Store already replaced the value
+            if ((word.load(std::memory_order_acquire) & ~SLEEPING) != val) return;
+        }
+    }
+
+    auto Store(std::atomic<std::uint32_t>& word, std::uint32_t val) -> void {
+        if ((word.exchange(val, std::memory_order_acq_rel) & SLEEPING) != 0) FutexWake(word);
+    }
+
+    PinnedWorker::PinnedWorker(std::size_t cpu) : thread{ [this, cpu]() { Loop(cpu); } } {}
+
+    PinnedWorker::~PinnedWorker() { Store(slot, STOP); }
+
+    auto PinnedWorker::Run(std::function<void()> task) -> Handoff {
+        pending = std::move(task);
+        times = {};
+        times.posted = Clock::now();
+        Store(slot, FULL);
+        WaitWhile(slot, FULL);
+        times.observed = Clock::now();
+        Store(slot, EMPTY);
+        return times;
+    }
+
+    auto PinnedWorker::Loop(std::size_t cpu) -> void {
+        PinThisThreadToCore(cpu);
+        for (;;) {
+            WaitWhile(slot, EMPTY);
+            if ((slot.load(std::memory_order_acquire) & ~SLEEPING) == STOP) return;
+            times.started = Clock::now();
+            pending();
+            times.finished = Clock::now();
+            Store(slot, DONE);
+            WaitWhile(slot, DONE);
+        }
+    }
+}    // namespace Worker
@@ -0,0 +1,45 @@
+#ifndef WORKER_H
+#define WORKER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+#include "TscClock.h"
+
+// Long lived pinned worker fed through a single-slot mailbox, the dispatch alternative to a thread per task
+namespace Worker {
+    // Spins on word while it holds val, then sleeps on a futex until Store changes it
+    auto WaitWhile(std::atomic<std::uint32_t>& word, std::uint32_t val) -> void;
+    // Publishes val, wakes the waiter only if it went to sleep
+    auto Store(std::atomic<std::uint32_t>& word, std::uint32_t val) -> void;
+
+    class PinnedWorker {
+    public:
+        using Clock = TscClock;
+        struct Handoff {
+            Clock::time_point posted{};      // Poster filled the slot
+            Clock::time_point started{};     // Worker saw it and began the task
+            Clock::time_point finished{};    // Worker finished the task
+            Clock::time_point observed{};    // Poster saw the task done
+        };
+        explicit PinnedWorker(std::size_t cpu);
+        ~PinnedWorker();
+        PinnedWorker(const PinnedWorker&) = delete;
+        auto operator=(const PinnedWorker&) -> PinnedWorker& = delete;
+        // Runs task on the worker and blocks until it is done, one task in flight at a time
+        auto Run(std::function<void()> task) -> Handoff;
+
+    private:
+        enum State : std::uint32_t { EMPTY, FULL, DONE, STOP };
+        auto Loop(std::size_t cpu) -> void;
+        std::atomic<std::uint32_t> slot{ EMPTY };
+        std::function<void()> pending{};
+        Handoff times{};
+        std::jthread thread{};
+    };
+}    // namespace Worker
+
+#endif
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <barrier>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <print>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <pthread.h>
+
+#include "Barrier.h"
+#include "TscClock.h"
+
+// Per-episode latency of the barriers in Barrier.h against std::barrier, swept over team sizes
+// ./barrier_bench
+
+namespace {
+    using Clock = TscClock;
+    using Nanos = std::chrono::nanoseconds;
+
+    constexpr std::size_t EPISODES = 100'000;
+    constexpr std::size_t WARMUP_EPISODES = 1'000;
+
+    template<typename Func, typename... Args> constexpr void CallPosix(Func&& func, Args&&... args) {
+        const int err = std::forward<Func>(func)(std::forward<Args>(args)...);
+        if (err != 0) {
+            std::println(stdout, "CallPosix Error {}", std::strerror(err));
+            std::fflush(stdout);
+            std::abort();
+        }
+    }
+    auto PinThisThreadToCore(std::size_t core) -> void {
+        core %= std::jthread::hardware_concurrency();
+        cpu_set_t cpu_mask;
+        CPU_ZERO(&cpu_mask);
+        CPU_SET(core, &cpu_mask);
+        CallPosix(pthread_setaffinity_np, pthread_self(), sizeof(cpu_mask), &cpu_mask);
+    }
+
+    class Std {
+    public:
+        explicit Std(std::size_t threads)
+            : barrier{ static_cast<std::ptrdiff_t>(threads) } {}
+        auto ArriveAndWait([[maybe_unused]] std::size_t tid) -> void { barrier.arrive_and_wait(); }
+
+    private:
+        std::barrier<> barrier;
+    };
+
+    // Powers of two up to the logical cpus, then the logical cpus themselves
+    auto ThreadCounts() -> std::vector<std::size_t> {
+        const std::size_t cpus = std::max(1U, std::jthread::hardware_concurrency());
+        std::vector<std::size_t> counts{};
+        for (std::size_t n = 1; n < cpus; n *= 2) counts.push_back(n);
+        counts.push_back(cpus);
+        return counts;
+    }
+
+    // Thread 0 times every episode, from its arrival at one barrier to its arrival at the next
+    template<typename BarrierType> auto Measure(std::string_view name, std::size_t threads) -> void {
+        BarrierType barrier{ threads };
+        std::vector<Nanos> samples(EPISODES);
+        {
+            std::vector<std::jthread> team{};
+            for (auto tid = 0UL; tid < threads; ++tid) {
+                team.emplace_back([tid, &barrier, &samples]() {
+                    PinThisThreadToCore(tid);
+                    for (auto i = 0UL; i < WARMUP_EPISODES; ++i) barrier.ArriveAndWait(tid);
+                    if (tid != 0) {
+                        for (auto i = 0UL; i < EPISODES; ++i) barrier.ArriveAndWait(tid);
+                        return;
+                    }
+                    for (auto& sample : samples) {
+                        const auto begin = Clock::now();
+                        barrier.ArriveAndWait(tid);
+                        sample = std::chrono::duration_cast<Nanos>(Clock::now() - begin);
+                    }
+                });
+            }
+        }
+        Nanos total{};
+        for (const auto sample : samples) total += sample;
+        std::ranges::sort(samples);
+        const auto percentile = [&samples](std::size_t p) { return samples[samples.size() * p / 1000].count(); };
+        std::println("{}_{}: mean {} ns, p50 {} ns, p99 {} ns, p99.9 {} ns, max {} ns", name, threads, total.count() / static_cast<long>(EPISODES), percentile(500),
+                     percentile(990), percentile(999), samples.back().count());
+    }
+}    // namespace
+
+auto main() -> int {
+    std::println("Episodes: {}, samples include one TscClock read", EPISODES);
+    for (const auto threads : ThreadCounts()) {
+        Measure<Std>("StdBarrier", threads);
+        Measure<Barrier::Futex>("Futex", threads);
+        Measure<Barrier::SenseReversing>("SenseReversing", threads);
+        Measure<Barrier::CombiningTree>("CombiningTree", threads);
+        Measure<Barrier::Dissemination>("Dissemination", threads);
+        Measure<Barrier::Tournament>("Tournament", threads);
+    }
+    return 0;
+}
@@ -1,22 +1,33 @@
 #include <algorithm>
 #include <array>
+#include <barrier>
+#include <charconv>
 #include <chrono>
 #include <cstddef>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
-#include <limits>
 #include <memory>
 #include <numeric>
+#include <optional>
 #include <print>
 #include <random>
+#include <ranges>
+#include <span>
+#include <sstream>
+#include <string>
 #include <string_view>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #include <cassert>
 #include <cerrno>
 #include <cstdlib>
+#include <cstring>
 
+#include <cpuid.h>
+#include <immintrin.h>
 #include <pthread.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -28,7 +39,15 @@
 #include <libpmemobj++/pool.hpp>
 #include <libpmemobj++/transaction.hpp>
 
+#include <libpmem.h>
+
+#include "Evict.h"
 #include "Instrumenter.h"
+#include "Kernels.h"
+#include "PmemEmu.h"
+#include "Prefault.h"
+#include "Topology.h"
+#include "Worker.h"
 
 // #define WBINVD_ENABLED
 
@@ -42,14 +61,15 @@ constexpr std::size_t CACHE_LINE_SIZE = 64;
 // constexpr std::size_t CACHE_SIZE = (1024 * 1024 * 0.125) * 37.28;    // 37.28MB titan L3+L2+L1D ~37.3MB
 // constexpr std::size_t PERSISTENT_ARR_LEN = 2 * CACHE_SIZE;
 [[maybe_unused]] constexpr std::size_t L1 = 1UL * 1024 * 48;           // 48KB titan L1 Data
-[[maybe_unused]] constexpr std::size_t L2 = 1UL * 1024 * 1;            // 1MB titan L2
+[[maybe_unused]] constexpr std::size_t L2 = 1UL * 1024 * 1024 * 1;     // 1MB titan L2
 [[maybe_unused]] constexpr std::size_t L3 = 1UL * 1024 * 1024 * 36;    // 36MB titan L3
-constexpr std::size_t PERSISTENT_ARRAY_SIZE = L3;
+constexpr std::size_t PERSISTENT_ARRAY_SIZE = 2 * L3;    // Room for working sets that spill out of L3
 // Allocate only for L3, not for L1+L2+L3, since whatever exists in L3 also exists on L1 and L2
 //  constexpr std::size_t CACHE_SIZE = (1024 * 1024) * 1;       // 8MB mamalakispc L3 8MB
 constexpr std::size_t REPETITIONS = 10;
+constexpr std::size_t PREPARE_CPU = 0;    // main thread and the preparing thread of the cross-core wrappers
 
-constexpr std::string_view POOL_PATH = "/mnt/pmem0/myrontsa/CacheWarmPool";
+constexpr std::string_view POOL_NAME = "CacheWarmPool";    // Under PMEM_POOL_ROOT
 constexpr std::size_t POOL_SIZE = 4 * L3;
 struct Root {
     constexpr static std::size_t PADDING_SZ = 48;
@@ -60,15 +80,30 @@ static_assert(POOL_SIZE >= sizeof(Root));
 namespace {
     pmem::obj::pool<Root> Pool{};
 
-    constexpr size_t COOLING_BUFFER_SIZE = 2 * PERSISTENT_ARRAY_SIZE;
-    std::array<std::byte, COOLING_BUFFER_SIZE> CoolingBuffer{};
+    constexpr size_t COOLING_BUFFER_SIZE = 2 * L3;
+    alignas(CACHE_LINE_SIZE) std::array<std::byte, COOLING_BUFFER_SIZE> CoolingBuffer{};
+    std::unique_ptr<Evict::Sweeper> EvictionSweeper{};    // Only allocated when an experiment uses EvictCachePrepare
+    std::unique_ptr<Worker::PinnedWorker> PoolWorker{};    // Only started when an experiment uses PoolWrapper
 }    // namespace
 
 namespace {
-    [[maybe_unused]] auto InitializeArray(Root* root) -> void {
-        auto& array = root->array;
-        for (auto i = 0UL; i < array.size(); ++i) array.at(i) = std::byte{ static_cast<std::byte>(i) };
-        // for (const auto& b : array) std::print("{} ", std::to_integer<std::size_t>(b));
+    // Cpus on the socket of PREPARE_CPU, the pool pages are faulted from the node that runs the experiments
+    auto PrefaultCpus() -> std::vector<std::size_t> {
+        const std::vector<Topology::Cpu> cpus = Topology::ReadCpus();
+        const auto prepare = std::ranges::find(cpus, PREPARE_CPU, &Topology::Cpu::id);
+        std::vector<std::size_t> local{};
+        for (const auto& cpu : cpus)
+            if (prepare == cpus.end() || cpu.package == prepare->package) local.push_back(cpu.id);
+        return local;
+    }
+    // Bytes repeat 0..7 per word, nothing reads them before a bench writes its own
+    [[maybe_unused]] auto InitializeArray(pmem::obj::pool<Root>& pool) -> void {
+        constexpr std::uint64_t PATTERN = 0x0706050403020100;
+        const auto elapsed = Prefault::Run(pool.root()->array, PrefaultCpus(), [&pool](std::span<std::byte> slice, std::size_t) {
+            Kernels::Fill(slice, PATTERN);
+            pool.persist(slice.data(), slice.size());
+        });
+        std::println("Initialize array: {} ms", std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
     }
     template<typename Func, typename... Args> constexpr void CallPosix(Func&& func, Args&&... args) {
         const int err = std::forward<Func>(func)(std::forward<Args>(args)...);
@@ -94,35 +129,59 @@ namespace {
             std::abort();
         }
     }
+    // Traces a span measured outside a Timer, same timestamp origin as Timer
+    auto AddSpanTrace(const std::string& name, Timer::TimePoint begin, Timer::TimePoint end) -> void {
+        Instrumenter::Get().AddTrace({ name, std::chrono::duration_cast<Unit>(begin - Timer::TimePoint::min()), std::chrono::duration_cast<Unit>(end - begin) });
+    }
     template<typename T> auto IsAligned(const T* ptr, std::size_t align) -> bool { return (std::bit_cast<std::uintptr_t>(ptr) % align) == 0; }
+    // Keeps val alive without the volatile store per element the old loops paid for
+    template<typename T> auto DoNotOptimize(const T& val) -> void { asm volatile("" : : "r,m"(val) : "memory"); }
+
+    // 64-byte elements are a GCC vector, lowered to one AVX-512 or two AVX2 loads/stores with -march=native
+    using Vec64 = std::uint64_t __attribute__((vector_size(64)));
+    template<std::size_t WIDTH> using Word = std::conditional_t<WIDTH == 1, std::uint8_t, std::conditional_t<WIDTH == 8, std::uint64_t, Vec64>>;
+    // Out-parameter, a 64-byte vector returned by value changes the ABI without AVX-512F and GCC warns with -Wpsabi
+    template<std::size_t WIDTH> auto Load(const std::byte* ptr, Word<WIDTH>& word) -> void { std::memcpy(&word, ptr, WIDTH); }
+    template<std::size_t WIDTH> auto LoadXor(const std::byte* ptr, Word<WIDTH>& acc) -> void {
+        Word<WIDTH> word;
+        Load<WIDTH>(ptr, word);
+        acc ^= word;
+    }
+    template<std::size_t WIDTH> auto Store(std::byte* ptr, std::size_t val) -> void {
+        Word<WIDTH> word{};
+        if constexpr (WIDTH == 64) word += val;
+        else word = static_cast<Word<WIDTH>>(val);
+        std::memcpy(ptr, &word, WIDTH);
+    }
+    // Non-temporal stores bypass the cache, an sfence orders them before the write counts as persisted
+    template<std::size_t WIDTH> auto StreamStore(std::byte* ptr, std::size_t val) -> void {
+        static_assert(WIDTH == 8 || WIDTH == 64, "no non-temporal store of this width");
+        if constexpr (WIDTH == 8) {
+            _mm_stream_si64(std::bit_cast<long long*>(ptr), static_cast<long long>(val));
+        } else {
+#if defined(__AVX512F__)
+            _mm512_stream_si512(std::bit_cast<__m512i*>(ptr), _mm512_set1_epi64(static_cast<long long>(val)));
+#elif defined(__AVX__)
+            _mm256_stream_si256(std::bit_cast<__m256i*>(ptr), _mm256_set1_epi64x(static_cast<long long>(val)));
+            _mm256_stream_si256(std::bit_cast<__m256i*>(ptr + 32), _mm256_set1_epi64x(static_cast<long long>(val)));
+#else
+            for (auto i = 0UL; i < WIDTH; i += 8) _mm_stream_si64(std::bit_cast<long long*>(ptr + i), static_cast<long long>(val));
+#endif
+        }
+    }
+    auto HasClwb() -> bool {
+        unsigned eax{}, ebx{}, ecx{}, edx{};
+        if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) == 0) return false;
+        return (ebx & bit_CLWB) != 0;
+    }
+    // Writes the line back without invalidating it, unlike clflush(opt)
+    __attribute__((target("clwb"))) auto WriteBackLine(std::byte* ptr) -> void { _mm_clwb(ptr); }
 }    // namespace
 
 namespace {
-    auto WarmCachePrepare() -> void {
-        const auto& array = Pool.root()->array;
-        for (const auto& b : array) [[maybe_unused]]
-            volatile auto temp = b;
-    }
-    auto CoolCachePrepare() -> void {
-        for (auto i = 0UL; i < CoolingBuffer.size(); ++i) CoolingBuffer[i] = std::byte{ static_cast<std::byte>(i) };
-    }
-    auto ComplexCoolCachePrepare() -> void {
-        CoolingBuffer.fill(std::byte{ 1 });
-        std::random_device r;
-        std::default_random_engine e(r());
-        std::uniform_int_distribution<std::uint8_t> uniform_dist(std::numeric_limits<std::uint8_t>::min(), std::numeric_limits<std::uint8_t>::max());
-        for (auto& b : CoolingBuffer) b = std::byte{ uniform_dist(e) };
-        /*
-            auto coolingBufferIndexes = std::make_unique<std::array<size_t, COOLING_BUFFER_SIZE>>();
-            for (auto begin = std::begin(*coolingBufferIndexes); begin < std::end(*coolingBufferIndexes); begin += COOLING_BUFFER_SIZE)
-                std::iota(begin, begin + COOLING_BUFFER_SIZE, 0);
-            std::ranges::shuffle(*coolingBufferIndexes, e);
-            for (auto i = 0UL; i < coolingBufferIndexes->size(); ++i) {
-                const auto idx = coolingBufferIndexes->at(i);
-                [[maybe_unused]] volatile auto temp = CoolingBuffer->at(idx);
-            }
-        */
-    }
+    auto WarmCachePrepare(std::size_t size) -> void { Kernels::WarmLines(std::span{ Pool.root()->array }.first(size)); }
+    auto CoolCachePrepare() -> void { Kernels::Fill(CoolingBuffer, 1); }
+    auto ComplexCoolCachePrepare() -> void { Kernels::RandomFill(CoolingBuffer, std::random_device{}()); }
     auto InvalidateCachePrepare() -> void {
 // [[maybe_unused]] int ret = std::system("sudo cat /proc/wbinvd");
 // assert(ret >= 0);
@@ -132,55 +191,364 @@ namespace {
         std::this_thread::sleep_for(SLEEP_DUR);
 #endif
     }
-    auto InvalidateWarmCachePrepare() -> void {
+    // Unprivileged alternatives to InvalidateCachePrepare, they only evict the working set, not the whole hierarchy
+    auto FlushCachePrepare(std::size_t size) -> void { Evict::FlushRange(std::span{ Pool.root()->array }.first(size)); }
+    auto EvictCachePrepare() -> void { EvictionSweeper->Sweep(); }
+    auto InvalidateWarmCachePrepare(std::size_t size) -> void {
         InvalidateCachePrepare();
-        WarmCachePrepare();
+        WarmCachePrepare(size);
+    }
+}    // namespace
+
+namespace {
+    enum class WrapperType {
+        NoWrapper,
+        ThreadWrapper,
+        SystemCallWrapper,
+        ForkWrapper,
+        SameCoreWrapper,
+        SmtSiblingWrapper,
+        SameSocketWrapper,
+        RemoteSocketWrapper,
+        SplitWrapper,
+        PoolWrapper,
+    };
+    enum class PrepareType {
+        None,
+        WarmCachePrepare,
+        CoolCachePrepare,
+        ComplexCoolCachePrepare,
+        InvalidateCachePrepare,
+        InvalidateWarmCachePrepare,
+        FlushCachePrepare,
+        EvictCachePrepare,
+    };
+    // WriteBench stores then persists the range, the other write paths are timed against it
+    enum class BenchType { None, ReadBench, WriteBench, NtWriteBench, ClwbWriteBench, MemcpyPersistWriteBench, MemsetPersistWriteBench };
+    // Sequential touches every element, Strided and Random one element per cache line, PointerChase one dependent load per line
+    enum class PatternType { Sequential, Strided, Random, PointerChase };
+
+    template<typename T> struct Named {
+        std::string_view name;
+        T value;
+    };
+    constexpr auto WRAPPERS = std::to_array<Named<WrapperType>>({
+        { "NoWrapper", WrapperType::NoWrapper },
+        { "ThreadWrapper", WrapperType::ThreadWrapper },
+        { "SystemCallWrapper", WrapperType::SystemCallWrapper },
+        { "ForkWrapper", WrapperType::ForkWrapper },
+        { "SameCoreWrapper", WrapperType::SameCoreWrapper },
+        { "SmtSiblingWrapper", WrapperType::SmtSiblingWrapper },
+        { "SameSocketWrapper", WrapperType::SameSocketWrapper },
+        { "RemoteSocketWrapper", WrapperType::RemoteSocketWrapper },
+        { "SplitWrapper", WrapperType::SplitWrapper },
+        { "PoolWrapper", WrapperType::PoolWrapper },
+    });
+    // Prepare runs on PREPARE_CPU, the benchmark on the peer cpu
+    constexpr auto PLACEMENTS = std::to_array<Named<Topology::Placement>>({
+        { "SameCoreWrapper", Topology::Placement::SameCore },
+        { "SmtSiblingWrapper", Topology::Placement::SmtSibling },
+        { "SameSocketWrapper", Topology::Placement::SameSocket },
+        { "RemoteSocketWrapper", Topology::Placement::RemoteSocket },
+    });
+    constexpr auto PREPARES = std::to_array<Named<PrepareType>>({
+        { "None", PrepareType::None },
+        { "WarmCachePrepare", PrepareType::WarmCachePrepare },
+        { "CoolCachePrepare", PrepareType::CoolCachePrepare },
+        { "ComplexCoolCachePrepare", PrepareType::ComplexCoolCachePrepare },
+        { "InvalidateCachePrepare", PrepareType::InvalidateCachePrepare },
+        { "InvalidateWarmCachePrepare", PrepareType::InvalidateWarmCachePrepare },
+        { "FlushCachePrepare", PrepareType::FlushCachePrepare },
+        { "EvictCachePrepare", PrepareType::EvictCachePrepare },
+    });
+    constexpr auto BENCHES = std::to_array<Named<BenchType>>({
+        { "None", BenchType::None },
+        { "ReadBench", BenchType::ReadBench },
+        { "WriteBench", BenchType::WriteBench },
+        { "NtWriteBench", BenchType::NtWriteBench },
+        { "ClwbWriteBench", BenchType::ClwbWriteBench },
+        { "MemcpyPersistWriteBench", BenchType::MemcpyPersistWriteBench },
+        { "MemsetPersistWriteBench", BenchType::MemsetPersistWriteBench },
+    });
+    constexpr auto PATTERNS = std::to_array<Named<PatternType>>({
+        { "Sequential", PatternType::Sequential },
+        { "Strided", PatternType::Strided },
+        { "Random", PatternType::Random },
+        { "PointerChase", PatternType::PointerChase },
+    });
+    constexpr auto WIDTHS = std::to_array<Named<std::size_t>>({ { "1", 1 }, { "8", 8 }, { "64", CACHE_LINE_SIZE } });
+    constexpr auto SIZES = std::to_array<Named<std::size_t>>({ { "L1", L1 }, { "L2", L2 }, { "L3", L3 }, { "2xL3", 2 * L3 } });
+    constexpr auto SIZE_SUFFIXES = std::to_array<Named<std::size_t>>({ { "", 1 }, { "K", 1024 }, { "M", 1024 * 1024 } });
+
+    struct ExperimentConfig {
+        std::string name{};
+        WrapperType wrapper{};
+        PrepareType prepare{};
+        BenchType bench{};
+        PatternType pattern{};
+        std::size_t width{};
+        std::size_t size{};
+        std::size_t repetitions{};
+        std::vector<std::size_t> benchCpus{};    // Cross-core and split wrappers only, one cpu per benchmark thread
+    };
+
+    // One matrix expands to the cartesian product wrappers x prepares x benches x patterns x widths x sizes
+    // Defaults reproduce the Main/Thread x None/Invalidate read experiments
+    struct MatrixSpec {
+        std::vector<std::string> wrappers{ "NoWrapper", "ThreadWrapper" };
+        std::vector<std::string> prepares{ "None", "InvalidateCachePrepare" };
+        std::vector<std::string> benches{ "ReadBench" };
+        std::vector<std::string> patterns{ "Sequential" };
+        std::vector<std::string> widths{ "1" };
+        std::vector<std::string> sizes{ "L3" };
+        std::vector<std::string> readers{ "1" };    // SplitWrapper only
+        std::size_t repetitions{ REPETITIONS };
+    };
+
+    [[noreturn]] auto ConfigError(std::string_view what, std::string_view val) -> void {
+        std::println(stdout, "Config Error: {} '{}'", what, val);
+        std::fflush(stdout);
+        std::exit(EXIT_FAILURE);
+    }
+    template<typename T, std::size_t N> auto Lookup(const std::array<Named<T>, N>& table, std::string_view dimension, std::string_view val) -> T {
+        for (const auto& [name, value] : table)
+            if (name == val) return value;
+        ConfigError(dimension, val);
+    }
+    auto ParseNumber(std::string_view val) -> std::size_t {
+        std::size_t num{};
+        const auto [ptr, ec] = std::from_chars(val.data(), val.data() + val.size(), num);
+        if (ec != std::errc{} || ptr != val.data() + val.size()) ConfigError("number", val);
+        return num;
+    }
+    // L1, L2, L3, 2xL3 or a byte count with optional K/M suffix, e.g. 4096, 64K, 8M
+    auto ParseSize(std::string_view val) -> std::size_t {
+        for (const auto& [name, value] : SIZES)
+            if (name == val) return value;
+        const auto digits = val.find_first_not_of("0123456789");
+        const std::size_t multiplier = Lookup(SIZE_SUFFIXES, "size suffix", digits == std::string_view::npos ? "" : val.substr(digits));
+        const std::size_t size = ParseNumber(val.substr(0, digits)) * multiplier;
+        if (size == 0 || size % CACHE_LINE_SIZE != 0) ConfigError("size must be a non-zero multiple of CACHE_LINE_SIZE", val);
+        if (size > PERSISTENT_ARRAY_SIZE) ConfigError("size exceeds PERSISTENT_ARRAY_SIZE", val);
+        return size;
+    }
+    auto Split(std::string_view str, char delim) -> std::vector<std::string> {
+        std::vector<std::string> tokens{};
+        for (const auto token : std::views::split(str, delim)) tokens.emplace_back(std::string_view{ token });
+        return tokens;
+    }
+    // key=v1,v2,... with an optional leading "--"
+    auto ParseMatrixToken(MatrixSpec& spec, std::string_view token) -> void {
+        if (token.starts_with("--")) token.remove_prefix(2);
+        const auto eq = token.find('=');
+        if (eq == std::string_view::npos) ConfigError("expected key=values", token);
+        const std::string_view key = token.substr(0, eq);
+        auto values = Split(token.substr(eq + 1), ',');
+        if (values.empty()) ConfigError("empty values", token);
+        if (key == "wrappers") spec.wrappers = std::move(values);
+        else if (key == "prepares") spec.prepares = std::move(values);
+        else if (key == "benches") spec.benches = std::move(values);
+        else if (key == "patterns") spec.patterns = std::move(values);
+        else if (key == "widths") spec.widths = std::move(values);
+        else if (key == "sizes") spec.sizes = std::move(values);
+        else if (key == "readers") spec.readers = std::move(values);
+        else if (key == "repetitions") spec.repetitions = ParseNumber(token.substr(eq + 1));
+        else ConfigError("unknown key", key);
+    }
+    // Benchmark cpus of the cross-core and split wrappers, checked against the topology of this machine
+    auto PickBenchCpus(WrapperType wrapper, std::string_view wrapperStr, std::size_t readers) -> std::vector<std::size_t> {
+        static const std::vector<Topology::Cpu> cpus = Topology::ReadCpus();
+        if (wrapper == WrapperType::SplitWrapper) {
+            auto order = Topology::SpreadOrder(cpus, PREPARE_CPU);
+            if (readers == 0 || readers > order.size()) ConfigError("readers must be between 1 and the online cpus", std::to_string(readers));
+            order.resize(readers);
+            return order;
+        }
+        for (const auto& [name, placement] : PLACEMENTS) {
+            if (name != wrapperStr) continue;
+            const auto peer = Topology::PickPeer(cpus, PREPARE_CPU, placement);
+            if (!peer) ConfigError("no cpu on this machine for", wrapperStr);
+            return { *peer };
+        }
+        return {};
+    }
+    auto ExpandMatrix(const MatrixSpec& spec, std::vector<ExperimentConfig>& experiments) -> void {
+        if (spec.repetitions == 0) ConfigError("repetitions", "0");
+        for (const auto& wrapperBaseStr : spec.wrappers)
+            for (const auto& readersStr : spec.readers) {
+                const WrapperType wrapper = Lookup(WRAPPERS, "wrapper", wrapperBaseStr);
+                const std::size_t readers = ParseNumber(readersStr);
+                // Only SplitWrapper expands over readers, keyed e.g. SplitWrapper4
+                if (wrapper != WrapperType::SplitWrapper && &readersStr != &spec.readers.front()) continue;
+                const std::string wrapperStr = wrapper == WrapperType::SplitWrapper ? wrapperBaseStr + readersStr : wrapperBaseStr;
+                const std::vector<std::size_t> benchCpus = PickBenchCpus(wrapper, wrapperBaseStr, readers);
+                for (const auto& prepareStr : spec.prepares)
+                    for (const auto& benchStr : spec.benches)
+                        for (const auto& patternStr : spec.patterns)
+                            for (const auto& widthStr : spec.widths)
+                                for (const auto& sizeStr : spec.sizes) {
+                                    ExperimentConfig config{
+                                        .name = wrapperStr + "_" + prepareStr + "_" + benchStr + "_" + patternStr + "_" + widthStr + "_" + sizeStr,
+                                        .wrapper = wrapper,
+                                        .prepare = Lookup(PREPARES, "prepare", prepareStr),
+                                        .bench = Lookup(BENCHES, "bench", benchStr),
+                                        .pattern = Lookup(PATTERNS, "pattern", patternStr),
+                                        .width = Lookup(WIDTHS, "width", widthStr),
+                                        .size = ParseSize(sizeStr),
+                                        .repetitions = spec.repetitions,
+                                        .benchCpus = benchCpus,
+                                    };
+                                    // system_call_main runs its own benchmark, every other wrapper needs one
+                                    if ((config.wrapper == WrapperType::SystemCallWrapper) != (config.bench == BenchType::None))
+                                        ConfigError("SystemCallWrapper takes bench None, other wrappers require a bench", config.name);
+                                    // The chain stores 8-byte offsets, following it is a read
+                                    if (config.pattern == PatternType::PointerChase && (config.bench != BenchType::ReadBench || config.width != 8))
+                                        ConfigError("PointerChase requires bench ReadBench and width 8", config.name);
+                                    if (config.bench == BenchType::NtWriteBench && config.width == 1) ConfigError("NtWriteBench requires width 8 or 64", config.name);
+                                    if (config.bench == BenchType::ClwbWriteBench && !HasClwb()) ConfigError("clwb not supported on this cpu", config.name);
+                                    // libpmem bulk copies move whole contiguous ranges
+                                    if ((config.bench == BenchType::MemcpyPersistWriteBench || config.bench == BenchType::MemsetPersistWriteBench)
+                                        && (config.pattern != PatternType::Sequential || config.width != CACHE_LINE_SIZE))
+                                        ConfigError("libpmem write benches require pattern Sequential and width 64", config.name);
+#ifndef WBINVD_ENABLED
+                                    if (config.prepare == PrepareType::InvalidateCachePrepare || config.prepare == PrepareType::InvalidateWarmCachePrepare)
+                                        std::println(stdout, "Config Warning: WBINVD_ENABLED not defined, {} does not invalidate", config.name);
+#endif
+                                    experiments.emplace_back(std::move(config));
+                                }
+            }
+    }
+    auto ParseConfigFile(std::string_view path, std::vector<ExperimentConfig>& experiments) -> void {
+        std::ifstream f{ std::string{ path } };
+        if (!f) ConfigError("cannot open config file", path);
+        std::string line{};
+        while (std::getline(f, line)) {
+            line = line.substr(0, line.find('#'));
+            MatrixSpec spec{};
+            bool empty = true;
+            std::istringstream tokens{ line };
+            for (std::string token{}; tokens >> token; empty = false) ParseMatrixToken(spec, token);
+            if (!empty) ExpandMatrix(spec, experiments);
+        }
+    }
+    // Every matrix is validated before any experiment runs
+    // cache_warm [--config=file] [--wrappers=..] [--prepares=..] [--benches=..] [--patterns=..] [--widths=..] [--sizes=..] [--readers=..] [--repetitions=N]
+    auto ParseArgs(int argc, char* argv[]) -> std::vector<ExperimentConfig> {
+        std::vector<ExperimentConfig> experiments{};
+        MatrixSpec cliSpec{};
+        bool cliGiven = false;
+        bool configGiven = false;
+        for (const std::string_view arg : std::span{ argv, static_cast<std::size_t>(argc) }.subspan(1)) {
+            if (arg.starts_with("--config=")) {
+                ParseConfigFile(arg.substr(std::string_view{ "--config=" }.size()), experiments);
+                configGiven = true;
+                continue;
+            }
+            if (!arg.starts_with("--")) ConfigError("expected --key=values", arg);
+            ParseMatrixToken(cliSpec, arg);
+            cliGiven = true;
+        }
+        if (cliGiven || !configGiven) ExpandMatrix(cliSpec, experiments);
+        if (experiments.empty()) ConfigError("no experiments", "");
+        return experiments;
     }
 }    // namespace
 
 class ExperimentDataType {
 private:
-    std::string name;
-    // size_t repetitions;
-    // size_t size;
-    std::function<void()> wrapperCallback;
-    std::function<void()> prepareCallback;
-    std::function<void()> benchmarkCallback;
+    ExperimentConfig config;
+    std::vector<std::uint32_t> lineOrder{};    // Random visiting order of cache lines, built before timing
 
-    [[nodiscard]] auto PickCallback(const std::string& val) const -> std::function<void()> {
-        if (val == "NoWrapper") return [this]() { NoWrapper(); };
-        if (val == "ThreadWrapper") return [this]() { ThreadWrapper(); };
-        if (val == "SystemCallWrapper") return [this]() { SystemCallWrapper(); };
-        if (val == "ForkWrapper") return [this]() { ForkWrapper(); };
-        if (val == "WarmCachePrepare") return []() { WarmCachePrepare(); };
-        if (val == "CoolCachePrepare") return []() { CoolCachePrepare(); };
-        if (val == "ComplexCoolCachePrepare") return []() { ComplexCoolCachePrepare(); };
-        if (val == "InvalidateCachePrepare") return []() { InvalidateCachePrepare(); };
-        if (val == "InvalidateWarmCachePrepare") return []() { InvalidateWarmCachePrepare(); };
-        if (val == "ReadBench") return [this]() { ReadBench(); };
-        if (val == "WriteBench") return [this]() { WriteBench(); };
-        if (val == "") return [](auto&&...) {};
-        std::unreachable();
-        // assert(false);
-        // return [](auto&&...) {};
+    auto BuildLineOrder() -> void {
+        const auto lines = static_cast<std::uint32_t>(config.size / CACHE_LINE_SIZE);
+        lineOrder.resize(lines);
+        std::iota(lineOrder.begin(), lineOrder.end(), 0U);
+        std::mt19937_64 gen{ std::random_device{}() };
+        std::ranges::shuffle(lineOrder, gen);
+    }
+    // Links every line of the range into a single random cycle, each line holds the byte offset of the next one
+    auto BuildPointerChain() const -> void {
+        const auto array = std::span{ Pool.root()->array }.first(config.size);
+        for (auto i = 0UL; i < lineOrder.size(); ++i) {
+            const std::uint64_t next = std::uint64_t{ lineOrder[(i + 1) % lineOrder.size()] } * CACHE_LINE_SIZE;
+            std::memcpy(&array[lineOrder[i] * CACHE_LINE_SIZE], &next, sizeof(next));
+        }
+        PmemEmu::Persist(Pool, array.data(), array.size_bytes());
+    }
+    // Calibrates the sweep to this working set and checks the prepare actually evicts it with a timed re-read
+    auto ValidateEviction() const -> void {
+        const auto array = std::span<const std::byte>{ Pool.root()->array }.first(config.size);
+        if (config.prepare == PrepareType::EvictCachePrepare) {
+            const std::size_t sweepSize = EvictionSweeper->Calibrate(array);
+            std::println("{} - sweep calibrated to {} bytes", config.name, sweepSize);
+        }
+        WarmCachePrepare(config.size);
+        const double hot = Evict::TimeReRead(array);
+        Prepare();
+        const double evicted = Evict::TimeReRead(array);
+        std::println("{} - re-read {:.2f} ns/line warm, {:.2f} ns/line after prepare", config.name, hot, evicted);
     }
 
 public:
-    ExperimentDataType(std::string_view _name, /* std::size_t _size,  */ const std::string& wrapperCallbackStr, const std::string& prepareCallbackStr,
-                       const std::string& benchmarkCallbackStr)
-        : name{ _name },
-          //   repetitions{ _repetitions },
-          //   size{ _size },
-          wrapperCallback{ PickCallback(wrapperCallbackStr) },
-          prepareCallback{ PickCallback(prepareCallbackStr) },
-          benchmarkCallback{ PickCallback(benchmarkCallbackStr) } {}
+    explicit ExperimentDataType(ExperimentConfig _config) : config{ std::move(_config) } {
+        if (config.pattern == PatternType::Random || config.pattern == PatternType::PointerChase) BuildLineOrder();
+        if (config.pattern == PatternType::PointerChase) BuildPointerChain();
+        if (config.prepare == PrepareType::FlushCachePrepare || config.prepare == PrepareType::EvictCachePrepare) ValidateEviction();
+    }
     auto Execute() const -> void {
-        assert(wrapperCallback);
-        assert(prepareCallback);
-        assert(benchmarkCallback);
-        for (auto i = 0UL; i < REPETITIONS; ++i) {
-            wrapperCallback();
-            std::println("{} - {} - done", i, name);
+        for (auto i = 0UL; i < config.repetitions; ++i) {
+            Wrap();
+            std::println("{} - {} - done", i, config.name);
+        }
+    }
+    auto Wrap() const -> void {
+        switch (config.wrapper) {
+            case WrapperType::NoWrapper: NoWrapper(); break;
+            case WrapperType::ThreadWrapper: ThreadWrapper(); break;
+            case WrapperType::SystemCallWrapper: SystemCallWrapper(); break;
+            case WrapperType::ForkWrapper: ForkWrapper(); break;
+            case WrapperType::SameCoreWrapper:
+            case WrapperType::SmtSiblingWrapper:
+            case WrapperType::SameSocketWrapper:
+            case WrapperType::RemoteSocketWrapper: CrossCoreWrapper(); break;
+            case WrapperType::SplitWrapper: SplitWrapper(); break;
+            case WrapperType::PoolWrapper: PoolWrapper(); break;
+        }
+    }
+    auto Prepare() const -> void {
+        switch (config.prepare) {
+            case PrepareType::None: break;
+            case PrepareType::WarmCachePrepare: WarmCachePrepare(config.size); break;
+            case PrepareType::CoolCachePrepare: CoolCachePrepare(); break;
+            case PrepareType::ComplexCoolCachePrepare: ComplexCoolCachePrepare(); break;
+            case PrepareType::InvalidateCachePrepare: InvalidateCachePrepare(); break;
+            case PrepareType::InvalidateWarmCachePrepare: InvalidateWarmCachePrepare(config.size); break;
+            case PrepareType::FlushCachePrepare: FlushCachePrepare(config.size); break;
+            case PrepareType::EvictCachePrepare: EvictCachePrepare(); break;
+        }
+    }
+    auto Benchmark() const -> void {
+        if (config.bench == BenchType::None) return;
+        TIME_SCOPE(config.name);
+        BenchmarkSlice(0, 1);
+    }
+    auto BenchmarkSlice(std::size_t tid, std::size_t threads) const -> void {
+        switch (config.bench) {
+            case BenchType::None: break;
+            case BenchType::ReadBench: DispatchWidth([this, tid, threads]<std::size_t WIDTH>() { ReadBench<WIDTH>(tid, threads); }); break;
+            case BenchType::WriteBench:
+            case BenchType::NtWriteBench:
+            case BenchType::ClwbWriteBench: DispatchWidth([this, tid, threads]<std::size_t WIDTH>() { WriteBench<WIDTH>(tid, threads); }); break;
+            case BenchType::MemcpyPersistWriteBench:
+            case BenchType::MemsetPersistWriteBench: PmemWriteBench(tid, threads); break;
+        }
+    }
+    auto DispatchWidth(auto&& bench) const -> void {
+        switch (config.width) {
+            case 1: bench.template operator()<1>(); break;
+            case 8: bench.template operator()<8>(); break;
+            case CACHE_LINE_SIZE: bench.template operator()<CACHE_LINE_SIZE>(); break;
+            default: assert(false);
         }
     }
     auto NoWrapper() const -> void { PrepareAndBenchmark(); }
@@ -190,6 +558,48 @@ public:
             PrepareAndBenchmark();
         });
     }
+    // Data is prepared on PREPARE_CPU and benchmarked on the placement peer, the cost of moving a request between workers
+    auto CrossCoreWrapper() const -> void {
+        {
+            std::jthread t([this]() {
+                PinThisThreadToCore(PREPARE_CPU);
+                Prepare();
+            });
+        }
+        std::jthread t([this]() {
+            PinThisThreadToCore(config.benchCpus.front());
+            Benchmark();
+        });
+    }
+    // Data is prepared on PREPARE_CPU, then benchCpus.size() readers each take a slice of the working set
+    auto SplitWrapper() const -> void {
+        {
+            std::jthread t([this]() {
+                PinThisThreadToCore(PREPARE_CPU);
+                Prepare();
+            });
+        }
+        const std::size_t threads = config.benchCpus.size();
+        std::barrier beginBarrier{ static_cast<std::ptrdiff_t>(threads) };
+        std::barrier endBarrier{ static_cast<std::ptrdiff_t>(threads) };
+        std::vector<std::jthread> readers{};
+        for (auto tid = 0UL; tid < threads; ++tid) {
+            readers.emplace_back([this, tid, threads, &beginBarrier, &endBarrier]() {
+                PinThisThreadToCore(config.benchCpus[tid]);
+                beginBarrier.arrive_and_wait();
+                std::optional<Timer> timer{};
+                if (tid == 0) timer.emplace(config.name);
+                BenchmarkSlice(tid, threads);
+                endBarrier.arrive_and_wait();
+            });
+        }
+    }
+    // The long lived worker pinned to core 1 runs the experiment, the dispatch cost a thread pool pays instead of thread creation
+    auto PoolWrapper() const -> void {
+        const auto handoff = PoolWorker->Run([this]() { PrepareAndBenchmark(); });
+        AddSpanTrace(config.name + "_Handoff", handoff.posted, handoff.started);
+        AddSpanTrace(config.name + "_Return", handoff.finished, handoff.observed);
+    }
     auto ForkWrapper() const -> void {
         const pid_t pid = fork();
         assert(pid >= 0);
@@ -206,122 +616,119 @@ public:
         exit(EXIT_SUCCESS);
     }
     auto SystemCallWrapper() const -> void {
-        prepareCallback();
+        Prepare();
         Pool.close();
         // [[maybe_unused]] int ret = std::system("./system_call_main");
         // assert(ret >= 0);
         System("./system_call_main");
-        const std::string layout = std::filesystem::path{ POOL_PATH }.filename().string();
-        const std::string poolPath{ POOL_PATH };
-        Pool = pmem::obj::pool<Root>::open(poolPath, layout);
+        Pool = pmem::obj::pool<Root>::open(PmemEmu::PoolPath(POOL_NAME), std::string{ POOL_NAME });
     }
     auto PrepareAndBenchmark() const -> void {
-        prepareCallback();
-        benchmarkCallback();
+        Prepare();
+        Benchmark();
     }
 
-    auto ReadBench() const -> void {
-        // for (auto i = 0UL; i < size; ++i) [[maybe_unused]]
-        //     volatile auto temp = RootPtr->array[i];
-        const auto& array = Pool.root()->array;
-        TIME_SCOPE(name);
-        for (const auto& b : array) [[maybe_unused]]
-            volatile auto temp = b;
-    }
-    auto WriteBench() const -> void {
-        // for (auto i = 0UL; i < size; ++i) RootPtr->array[i] = i;
-        auto& array = Pool.root()->array;
-        TIME_SCOPE(name);
-        for (auto i = 0UL; i < array.size(); ++i) array[i] = std::byte{ static_cast<std::byte>(i) };
-        Pool.persist(array.data(), sizeof(array));
+    // Thread tid of threads gets an equal share of the lines of the working set, and of lineOrder for Random and PointerChase
+    auto SliceLines(std::size_t tid, std::size_t threads) const -> std::pair<std::size_t, std::size_t> {
+        const std::size_t lines = config.size / CACHE_LINE_SIZE;
+        return { lines * tid / threads, lines * (tid + 1) / threads };
     }
-};
-
-namespace {
-    auto ReadExperiments() -> void {
-        {
-            // for (const auto& [size, suffix] : std::vector<std::tuple<size_t, std::string>>{ { L1, "L1" }, { L2, "L2" }, { L3, "L3" } })
-            ExperimentDataType{ "Main_Read", "NoWrapper", "", "ReadBench" }.Execute();
-            // for (const auto& size : { L1, L2, L3 })
-            ExperimentDataType{ "Main_Invalidate_Read", "NoWrapper", "InvalidateCachePrepare", "ReadBench" }.Execute();
-            // ExperimentDataType{ "Main_Invalidate_Warm_Read", "NoWrapper", "InvalidateWarmCachePrepare", "ReadBench" }.Execute();
-        }
-        {
-            // 1 Rep, restart executable with repeat_execution.sh
-            // ExperimentDataType{ "Main_Terminate_Read", 1, "NoWrapper", "", "ReadBench" }.Execute();
-            // ExperimentDataType{ "Main_Terminate_Invalidate_Read", 1, "NoWrapper", "InvalidateCachePrepare", "ReadBench" }.Execute();
-        }
-        {
-            // for (const auto& size : { L1, L2, L3 })
-            ExperimentDataType{ "Thread_Read", "ThreadWrapper", "", "ReadBench" }.Execute();
-            // for (const auto& size : { L1, L2, L3 })
-            ExperimentDataType{ "Thread_Invalidate_Read", "ThreadWrapper", "InvalidateCachePrepare", "ReadBench" }.Execute();
-            // ExperimentDataType{ "Thread_Invalidate_Warm_Read", "ThreadWrapper", "InvalidateWarmCachePrepare", "ReadBench" }.Execute();
-
-            // ExperimentDataType{ "Thread_Cool_Read", "ThreadWrapper", "CoolCachePrepare", "ReadBench" }.Execute();
-            // ExperimentDataType{ "Thread_ComplexCool_Read", "ThreadWrapper", "ComplexCoolCachePrepare", "ReadBench" }.Execute();
-        }
-        {
-            // 1 Rep, restart executable with repeat_execution.sh
-            // ExperimentDataType{ "Thread_Terminate_Read", 1, "ThreadWrapper", "", "ReadBench" }.Execute();
-            // ExperimentDataType{ "Thread_Terminate_Invalidate_Read", 1, "ThreadWrapper", "InvalidateCachePrepare", "ReadBench" }.Execute();
-        }
-        {
-            // System Call experiment, system_call_main.cpp manages parameters other than        // ExperimentDataType{ "System_Call_Read", "SystemCallWrapper", "", "" }.Execute();
-            // ExperimentDataType{ "System_Call_Invalidate_Read", "SystemCallWrapper", "InvalidateCachePrepare", "" }.Execute();
-        }
-        {
-            // ExperimentDataType{ "Fork_Read", "ForkWrapper", "", "ReadBench" }.Execute();
-            // ExperimentDataType{ "Fork_Invalidate_Read", "ForkWrapper", "InvalidateCachePrepare", "ReadBench" }.Execute();
-
-            // ExperimentDataType{ "Fork_Warm_Read", "ForkWrapper", "WarmCachePrepare", "ReadBench" }.Execute();
-            // ExperimentDataType{ "Fork_Cool_Read", "ForkWrapper", "CoolCachePrepare", "ReadBench" }.Execute();
-            // ExperimentDataType{ "Fork_ComplexCool_Read", "ForkWrapper", "ComplexCoolCachePrepare", "ReadBench" }.Execute();
+    template<std::size_t WIDTH> auto ReadBench(std::size_t tid, std::size_t threads) const -> void {
+        const auto [beginLine, endLine] = SliceLines(tid, threads);
+        const auto fullArray = std::span{ Pool.root()->array }.first(config.size);
+        const auto array = fullArray.subspan(beginLine * CACHE_LINE_SIZE, (endLine - beginLine) * CACHE_LINE_SIZE);
+        const std::span<const std::uint32_t> order{ lineOrder };
+        Word<WIDTH> acc{};
+        switch (config.pattern) {
+            case PatternType::Sequential:
+                for (auto i = 0UL; i < array.size(); i += WIDTH) LoadXor<WIDTH>(&array[i], acc);
+                break;
+            case PatternType::Strided:
+                for (auto i = 0UL; i < array.size(); i += CACHE_LINE_SIZE) LoadXor<WIDTH>(&array[i], acc);
+                break;
+            case PatternType::Random:
+                for (const auto line : order.subspan(beginLine, endLine - beginLine)) LoadXor<WIDTH>(&fullArray[line * CACHE_LINE_SIZE], acc);
+                break;
+            case PatternType::PointerChase: {
+                // Each thread follows its own segment of the single cycle
+                std::uint64_t offset = std::uint64_t{ order[beginLine] } * CACHE_LINE_SIZE;
+                for (auto i = beginLine; i < endLine; ++i) Load<8>(&fullArray[offset], offset);
+                DoNotOptimize(offset);
+                break;
+            }
         }
+        DoNotOptimize(acc);
     }
-    auto WriteExperiments() -> void {
-        {
-            // for (const auto& size : { L1, L2, L3 })
-            ExperimentDataType{ "Main_Write", "NoWrapper", "", "WriteBench" }.Execute();
-            // ExperimentDataType{ "Main_Invalidate_Write", "NoWrapper", "InvalidateCachePrepare", "WriteBench" }.Execute();
-        }
-        {
-            // 1 Rep, restart executable with repeat_execution.sh
-            // ExperimentDataType{ "Main_Terminate_Write", 1, "NoWrapper", "", "WriteBench" }.Execute();
-            // ExperimentDataType{ "Main_Terminate_Invalidate_Write", 1, "NoWrapper", "InvalidateCachePrepare", "WriteBench" }.Execute();
-        }
-        {
-            // ExperimentDataType{ "Thread_Write", "ThreadWrapper", "", "WriteBench" }.Execute();
-            // ExperimentDataType{ "Thread_Invalidate_Write", "ThreadWrapper", "InvalidateCachePrepare", "WriteBench" }.Execute();
-
-            // ExperimentDataType{ "Thread_Warm_Write", "ThreadWrapper", "WarmCachePrepare", "WriteBench" }.Execute();
-            // ExperimentDataType{ "Thread_Cool_Write", "ThreadWrapper", "CoolCachePrepare", "WriteBench" }.Execute();
-            // ExperimentDataType{ "Thread_ComplexCool_Write", "ThreadWrapper", "ComplexCoolCachePrepare", "WriteBench" }.Execute();
-        }
-        {
-            // System Call experiment, system_call_main.cpp manages parameters other than        // ExperimentDataType{ "System_Call_Write", "SystemCallWrapper", "", ""
-            // }.Execute(); ExperimentDataType{ "System_Call_Invalidate_Write", "SystemCallWrapper", "InvalidateCachePrepare", "" }.Execute();
-        }
-        {
-            // ExperimentDataType{ "Fork_Write", "ForkWrapper", "", "WriteBench" }.Execute();
-            // ExperimentDataType{ "Fork_Invalidate_Write", "ForkWrapper", "InvalidateCachePrepare", "WriteBench" }.Execute();
-
-            // ExperimentDataType{ "Fork_Warm_Write", "ForkWrapper", "WarmCachePrepare", "WriteBench" }.Execute();
-            // ExperimentDataType{ "Fork_Cool_Write", "ForkWrapper", "CoolCachePrepare", "WriteBench" }.Execute();
-            // ExperimentDataType{ "Fork_ComplexCool_Write", "ForkWrapper", "ComplexCoolCachePrepare", "WriteBench" }.Execute();
+    template<std::size_t WIDTH> auto WriteBench(std::size_t tid, std::size_t threads) const -> void {
+        const auto [beginLine, endLine] = SliceLines(tid, threads);
+        const auto fullArray = std::span{ Pool.root()->array }.first(config.size);
+        const auto array = fullArray.subspan(beginLine * CACHE_LINE_SIZE, (endLine - beginLine) * CACHE_LINE_SIZE);
+        const auto lines = config.pattern == PatternType::Random ? std::span<const std::uint32_t>{ lineOrder }.subspan(beginLine, endLine - beginLine) : std::span<const std::uint32_t>{};
+        // Applies store to every element of the slice in pattern order, lineEnd tells whether the element completes its cache line
+        const auto writeSlice = [this, fullArray, array, lines](auto&& store) {
+            switch (config.pattern) {
+                case PatternType::Sequential:
+                    for (auto i = 0UL; i < array.size(); i += WIDTH) store(&array[i], i, (i + WIDTH) % CACHE_LINE_SIZE == 0);
+                    break;
+                case PatternType::Strided:
+                    for (auto i = 0UL; i < array.size(); i += CACHE_LINE_SIZE) store(&array[i], i, true);
+                    break;
+                case PatternType::Random:
+                    for (const auto line : lines) store(&fullArray[line * CACHE_LINE_SIZE], line, true);
+                    break;
+                case PatternType::PointerChase: assert(false); break;
+            }
+        };
+        switch (config.bench) {
+            case BenchType::WriteBench: {
+                writeSlice([](std::byte* ptr, std::size_t val, bool) { Store<WIDTH>(ptr, val); });
+                std::optional<Timer> persistTimer{};
+                if (tid == 0) persistTimer.emplace(config.name + "_Persist");
+                // A random slice is scattered over the whole working set, persist only the lines of this thread
+                if (config.pattern != PatternType::Random) PmemEmu::Persist(Pool, array.data(), array.size_bytes());
+                else if (threads == 1) PmemEmu::Persist(Pool, fullArray.data(), fullArray.size_bytes());
+                else
+                    for (const auto line : lines) PmemEmu::Persist(Pool, &fullArray[line * CACHE_LINE_SIZE], CACHE_LINE_SIZE);
+                break;
+            }
+            case BenchType::NtWriteBench:
+                if constexpr (WIDTH != 1) writeSlice([](std::byte* ptr, std::size_t val, bool) { StreamStore<WIDTH>(ptr, val); });
+                _mm_sfence();
+                PmemEmu::Delay(endLine - beginLine, 1);
+                break;
+            case BenchType::ClwbWriteBench:
+                writeSlice([](std::byte* ptr, std::size_t val, bool lineEnd) {
+                    Store<WIDTH>(ptr, val);
+                    if (lineEnd) WriteBackLine(ptr);    // Any address within the line selects it
+                });
+                _mm_sfence();
+                PmemEmu::Delay(endLine - beginLine, 1);
+                break;
+            default: assert(false);
         }
     }
-}    // namespace
+    // libpmem picks its own instructions (NT stores above a size threshold, then flush and drain)
+    auto PmemWriteBench(std::size_t tid, std::size_t threads) const -> void {
+        const auto [beginLine, endLine] = SliceLines(tid, threads);
+        const auto array = std::span{ Pool.root()->array }.subspan(beginLine * CACHE_LINE_SIZE, (endLine - beginLine) * CACHE_LINE_SIZE);
+        if (config.bench == BenchType::MemcpyPersistWriteBench) pmem_memcpy_persist(array.data(), &CoolingBuffer[beginLine * CACHE_LINE_SIZE], array.size_bytes());
+        else pmem_memset_persist(array.data(), static_cast<int>(tid), array.size_bytes());
+        PmemEmu::Persisted(array.data(), array.size_bytes());
+    }
+};
 
-auto main() -> int {
+auto main(int argc, char* argv[]) -> int {
+    PmemEmu::Init();
+    const std::vector<ExperimentConfig> experiments = ParseArgs(argc, argv);
     CallPosix(pthread_setconcurrency, static_cast<int>(std::jthread::hardware_concurrency()));
 
-    const std::string layout = std::filesystem::path{ POOL_PATH }.filename().string();
-    const bool recovered = std::filesystem::exists(POOL_PATH);
-    const std::string poolPath{ POOL_PATH };
+    const std::string layout{ POOL_NAME };
+    const std::string poolPath = PmemEmu::PoolPath(POOL_NAME);
+    const bool recovered = std::filesystem::exists(poolPath);
     if (!recovered) {
+        PmemEmu::CreatePoolDir(poolPath);
         auto pool = pmem::obj::pool<Root>::create(poolPath, layout, POOL_SIZE);
-        InitializeArray(pool.root().get());
+        InitializeArray(pool);
         pool.close();
     }
     if (pmem::obj::pool<Root>::check(poolPath, layout) != 1) {
@@ -330,6 +737,8 @@ auto main() -> int {
         std::abort();
     }
     Pool = pmem::obj::pool<Root>::open(poolPath, layout);
+    const auto prefault = Prefault::Run(Pool.root()->array, PrefaultCpus());    // Page faults of the array stay out of the first experiments
+    std::println("Prefault array: {} ms", std::chrono::duration_cast<std::chrono::milliseconds>(prefault).count());
     // std::println("{:p}", static_cast<void*>(Pool.root()->array.data()));
 
     constexpr auto PrintAligned = [](const auto* ptr, const std::size_t align) { std::println("{}", std::bit_cast<std::uintptr_t>(ptr) % align); };
@@ -346,8 +755,11 @@ auto main() -> int {
 #endif
     INSTRUMENT_BEGIN_SESSION(TRACE_FILE_NAME);
 
-    ReadExperiments();
-    // WriteExperiments();
+    if (std::ranges::any_of(experiments, [](const auto& config) { return config.prepare == PrepareType::EvictCachePrepare; }))
+        EvictionSweeper = std::make_unique<Evict::Sweeper>();
+    if (std::ranges::any_of(experiments, [](const auto& config) { return config.wrapper == WrapperType::PoolWrapper; })) PoolWorker = std::make_unique<Worker::PinnedWorker>(1);
+    std::println("Prepare kernels: {}", Kernels::IsaName(Kernels::Selected()));
+    for (const auto& config : experiments) ExperimentDataType{ config }.Execute();
 
     INSTRUMENT_END_SESSION();
     // ret = std::system("sudo rmmod wbinvd.ko");
@@ -10,8 +10,10 @@
 #include <thread>
 #include <vector>
 
+#include "StartSkew.h"
+
 namespace {
-    using Clock = std::chrono::steady_clock;
+    using Clock = TscClock;
     using Timepoint = std::chrono::time_point<Clock>;
 
     template<typename Func, typename... Args> constexpr void CallPosix(Func&& func, Args&&... args) {
@@ -38,10 +40,12 @@ namespace {
     std::once_flag endFlag{};
     std::barrier beginBarrier{ TotalThreads };
     std::barrier endBarrier{ TotalThreads };
+    StartSkew::Recorder wakes{ TotalThreads };    // Each thread's wake from the begin barrier
 
     auto Workload([[maybe_unused]] size_t id) -> void { for (uint32_t i = 0u; i < std::numeric_limits<uint32_t>::max(); ++i); }
     auto ExecuteOneWriter(size_t id) -> void {
         beginBarrier.arrive_and_wait();
+        wakes.Record(id);
         if (id == 0) begin = Clock::now();
 
         Workload(id);
@@ -50,6 +54,7 @@ namespace {
     }
     auto ExecuteCallOnceWriter(size_t id) -> void {
         beginBarrier.arrive_and_wait();
+        wakes.Record(id);
         std::call_once(beginFlag, []() { begin = Clock::now(); });
         Workload(id);
         beginBarrier.arrive_and_wait();
@@ -59,16 +64,29 @@ namespace {
     std::barrier endBarrierFunc{ TotalThreads, []() { end = Clock::now(); } };
     auto ExecuteBarrierWriter(size_t id) -> void {
         beginBarrierFunc.arrive_and_wait();
+        wakes.Record(id);
         Workload(id);
         endBarrierFunc.arrive_and_wait();
     }
     auto ExecuteMultiWriter(size_t id) -> void {
         beginBarrier.arrive_and_wait();
+        wakes.Record(id);
         begin = Clock::now();
         Workload(id);
         beginBarrier.arrive_and_wait();
         end = Clock::now();
     }
+    Timepoint deadline{};
+    std::barrier deadlineBarrier{ TotalThreads, []() noexcept { deadline = StartSkew::Deadline(); } };
+    auto ExecuteDeadlineWriter(size_t id) -> void {
+        deadlineBarrier.arrive_and_wait();
+        StartSkew::SpinUntil(deadline);
+        wakes.Record(id);
+        if (id == 0) begin = deadline;
+        Workload(id);
+        beginBarrier.arrive_and_wait();
+        if (id == 0) end = Clock::now();
+    }
     auto WrapCallback(size_t id, auto cb) -> void {
         PinThisThreadToCore(id);
         cb(id);
@@ -84,6 +102,8 @@ namespace {
 
         std::cout << name << " Duration " << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count() << " ms\n";
         std::cout << name << " Total " << std::chrono::duration_cast<std::chrono::milliseconds>(totalEnd - totalBegin).count() << " ms\n";
+        const StartSkew::Summary skew = wakes.Summarize();
+        std::cout << name << " Wake Skew max " << skew.maxLateNs << " ns, mean " << skew.meanLateNs << " ns, spread " << skew.spreadNs << " ns\n";
     }
 
 }    // namespace
@@ -94,5 +114,6 @@ auto main() -> int {
     SpawnAndJoinThreads(ExecuteCallOnceWriter, "ExecuteCallOnceWriter");
     SpawnAndJoinThreads(ExecuteBarrierWriter, "ExecuteBarrierWriter");
     SpawnAndJoinThreads(ExecuteMultiWriter, "ExecuteMultiWriter");
+    SpawnAndJoinThreads(ExecuteDeadlineWriter, "ExecuteDeadlineWriter");
     return 0;
 }
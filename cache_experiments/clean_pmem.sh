@@ -2,5 +2,6 @@
 set -euo pipefail
 IFS=$'\n\t'
 
-rm -rf /mnt/pmem0/myrontsa/*
-ls -al /mnt/pmem0/myrontsa
+POOL_ROOT="${PMEM_POOL_ROOT:-/mnt/pmem0/myrontsa}"
+rm -rf "${POOL_ROOT:?}"/*
+ls -al "$POOL_ROOT"
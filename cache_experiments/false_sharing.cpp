@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <print>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <pthread.h>
+
+#include "CacheAligned.h"
+#include "TscClock.h"
+
+// Throughput of per-thread counters placed DISTANCES bytes apart in one page, the padding CacheAligned<T> needs on this machine
+// ./false_sharing
+
+namespace {
+    using Clock = TscClock;
+
+    constexpr std::size_t ITERATIONS = 1 << 24;    // Increments per thread
+    constexpr std::size_t PAGE_SIZE = 4096;
+    constexpr std::array<std::size_t, 6> DISTANCES{ 8, 16, 32, 64, 128, 256 };
+
+    template<typename Func, typename... Args> constexpr void CallPosix(Func&& func, Args&&... args) {
+        const int err = std::forward<Func>(func)(std::forward<Args>(args)...);
+        if (err != 0) {
+            std::println(stdout, "CallPosix Error {}", std::strerror(err));
+            std::fflush(stdout);
+            std::abort();
+        }
+    }
+    auto PinThisThreadToCore(std::size_t core) -> void {
+        core %= std::jthread::hardware_concurrency();
+        cpu_set_t cpu_mask;
+        CPU_ZERO(&cpu_mask);
+        CPU_SET(core, &cpu_mask);
+        CallPosix(pthread_setaffinity_np, pthread_self(), sizeof(cpu_mask), &cpu_mask);
+    }
+
+    struct FreeAligned {
+        auto operator()(std::uint64_t* ptr) const -> void { ::operator delete[](ptr, std::align_val_t{ PAGE_SIZE }); }
+    };
+
+    // Thread tid increments the counter at byte tid * distance, with a relaxed load and store so every increment reaches the cache
+    auto Measure(std::size_t threads, std::size_t distance) -> double {
+        const std::size_t words = std::max(threads * distance, PAGE_SIZE) / sizeof(std::uint64_t);
+        const std::unique_ptr<std::uint64_t[], FreeAligned> buffer{ new (std::align_val_t{ PAGE_SIZE }) std::uint64_t[words]{} };
+        std::barrier startBarrier{ static_cast<std::ptrdiff_t>(threads) };
+        Clock::time_point begin{};
+        Clock::time_point end{};
+        {
+            std::vector<std::jthread> team{};
+            for (auto tid = 0UL; tid < threads; ++tid) {
+                team.emplace_back([tid, distance, &buffer, &startBarrier, &begin, &end]() {
+                    PinThisThreadToCore(tid);
+                    std::atomic_ref<std::uint64_t> counter{ buffer[tid * distance / sizeof(std::uint64_t)] };
+                    startBarrier.arrive_and_wait();
+                    if (tid == 0) begin = Clock::now();
+                    for (auto i = 0UL; i < ITERATIONS; ++i) counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                    startBarrier.arrive_and_wait();
+                    if (tid == 0) end = Clock::now();
+                    if (counter.load(std::memory_order_relaxed) != ITERATIONS) std::abort();
+                });
+            }
+        }
+        return static_cast<double>(threads * ITERATIONS) / std::chrono::duration<double, std::micro>(end - begin).count();
+    }
+
+    // Two threads show the pairwise effect, every cpu shows it at full load
+    auto ThreadCounts() -> std::vector<std::size_t> {
+        const std::size_t cpus = std::max(1U, std::jthread::hardware_concurrency());
+        if (cpus <= 2) return { cpus };
+        return { 2, cpus };
+    }
+}    // namespace
+
+auto main() -> int {
+    std::println("CacheAligned<T> pads to {} bytes, line size reported by the cpu {}", Cache::FALSE_SHARING_SIZE, Cache::LineSizeMatches() ? "matches" : "differs");
+    for (const auto threads : ThreadCounts()) {
+        for (const auto distance : DISTANCES) std::println("Threads {} Distance {}: {:.1f} Mops/s", threads, distance, Measure(threads, distance));
+    }
+    return 0;
+}
@@ -0,0 +1,319 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <optional>
+#include <print>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <linux/mman.h>
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "PmemEmu.h"
+#include "TscClock.h"
+
+// Page size against TLB reach: dTLB misses and throughput of sequential and random accesses over one buffer
+// Anonymous memory with 4 KB pages, THP, hugetlbfs 2 MB and 1 GB, and the pool file mapped misaligned (4 KB) or 1 GB aligned (DAX huge faults)
+// ./hugepage_bench [--size-mb=2048], hugetlbfs needs pages reserved in /proc/sys/vm/nr_hugepages or with hugepagesz=1G at boot
+
+namespace {
+    using Clock = TscClock;
+    using Nanos = std::chrono::duration<double, std::nano>;
+
+    constexpr std::size_t CACHE_LINE_SIZE = 64;
+    constexpr std::size_t MB = 1024UL * 1024;
+    constexpr std::size_t GB = 1024 * MB;
+    constexpr std::size_t SMALL_PAGE_SIZE = 4096;
+    constexpr std::size_t DEFAULT_SIZE_MB = 2048;    // Far past the 4 KB TLB reach, within the reach of 2 MB pages
+    constexpr std::size_t ACCESSES = 1 << 24;
+    constexpr std::size_t BENCH_CPU = 0;
+    constexpr std::string_view POOL_NAME = "HugePagePool";    // Under PMEM_POOL_ROOT
+    constexpr std::size_t HUGE_2M = 2 * MB;
+    constexpr std::size_t HUGE_1G = GB;
+
+    template<typename Func, typename... Args> constexpr void CallPosix(Func&& func, Args&&... args) {
+        const int err = std::forward<Func>(func)(std::forward<Args>(args)...);
+        if (err != 0) {
+            std::println(stdout, "CallPosix Error {}", std::strerror(err));
+            std::fflush(stdout);
+            std::abort();
+        }
+    }
+    auto PinThisThreadToCore(std::size_t core) -> void {
+        core %= std::jthread::hardware_concurrency();
+        cpu_set_t cpu_mask;
+        CPU_ZERO(&cpu_mask);
+        CPU_SET(core, &cpu_mask);
+        CallPosix(pthread_setaffinity_np, pthread_self(), sizeof(cpu_mask), &cpu_mask);
+    }
+    template<typename T> auto DoNotOptimize(const T& val) -> void { asm volatile("" : : "r,m"(val) : "memory"); }
+
+    // A user-space hardware cache event of this thread, unavailable under a strict perf_event_paranoid or in most VMs
+    class PerfCounter {
+    public:
+        explicit PerfCounter(std::uint64_t config) {
+            perf_event_attr attr{};
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.size = sizeof(attr);
+            attr.config = config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+        PerfCounter(const PerfCounter&) = delete;
+        auto operator=(const PerfCounter&) -> PerfCounter& = delete;
+        ~PerfCounter() {
+            if (fd >= 0) close(fd);
+        }
+        auto Start() const -> void {
+            if (fd < 0) return;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+        auto Stop() const -> std::optional<std::uint64_t> {
+            if (fd < 0) return std::nullopt;
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            std::uint64_t count{};
+            if (read(fd, &count, sizeof(count)) != sizeof(count)) return std::nullopt;
+            return count;
+        }
+
+    private:
+        int fd{ -1 };
+    };
+    constexpr auto DtlbMissEvent(std::uint64_t op) -> std::uint64_t { return PERF_COUNT_HW_CACHE_DTLB | (op << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16); }
+
+    enum class Backing { Small, Thp, Huge2M, Huge1G, PoolSmall, PoolHuge };
+    struct BackingInfo {
+        std::string_view name;
+        Backing backing;
+    };
+    constexpr std::array<BackingInfo, 6> BACKINGS{ {
+        { "4K", Backing::Small },
+        { "THP", Backing::Thp },
+        { "Hugetlb2M", Backing::Huge2M },
+        { "Hugetlb1G", Backing::Huge1G },
+        { "Pool4K", Backing::PoolSmall },
+        { "PoolHuge", Backing::PoolHuge },
+    } };
+
+    // data is the benchmarked range, the region from base is what was mapped and is unmapped as a whole
+    class Mapping {
+    public:
+        Mapping(std::byte* _data, std::size_t _length, void* _base, std::size_t _baseLength)
+            : data{ _data }, length{ _length }, base{ _base }, baseLength{ _baseLength } {}
+        Mapping(const Mapping&) = delete;
+        auto operator=(const Mapping&) -> Mapping& = delete;
+        Mapping(Mapping&& other) noexcept
+            : data{ other.data }, length{ other.length }, base{ std::exchange(other.base, nullptr) }, baseLength{ other.baseLength } {}
+        auto operator=(Mapping&&) -> Mapping& = delete;
+        ~Mapping() {
+            if (base != nullptr) munmap(base, baseLength);
+        }
+        auto Span() const -> std::span<std::byte> { return { data, length }; }
+
+    private:
+        std::byte* data{};
+        std::size_t length{};
+        void* base{};
+        std::size_t baseLength{};
+    };
+
+    // hugetlbfs mappings are whole pages, the length is rounded up to pageSize
+    auto MapAnonymous(std::size_t size, std::size_t pageSize, int extraFlags) -> std::optional<Mapping> {
+        const std::size_t length = (size + pageSize - 1) / pageSize * pageSize;
+        void* ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | extraFlags, -1, 0);
+        if (ptr == MAP_FAILED) return std::nullopt;
+        return Mapping{ static_cast<std::byte*>(ptr), size, ptr, length };
+    }
+    // Anonymous memory 2 MB aligned so THP can back it from the first byte
+    auto MapThp(std::size_t size) -> std::optional<Mapping> {
+        const std::size_t length = size + HUGE_2M;
+        void* base = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) return std::nullopt;
+        auto* data = static_cast<std::byte*>(base) + (HUGE_2M - std::bit_cast<std::uintptr_t>(base) % HUGE_2M) % HUGE_2M;
+        if (madvise(data, size, MADV_HUGEPAGE) != 0) {
+            munmap(base, length);
+            return std::nullopt;
+        }
+        return Mapping{ data, size, base, length };
+    }
+    // The pool file at offset from a 1 GB boundary, 0 lets a DAX file system fault 1 GB or 2 MB pages, 4 KB forces 4 KB pages
+    auto MapPool(std::size_t size, std::size_t offset) -> std::optional<Mapping> {
+        const std::string path = PmemEmu::PoolPath(POOL_NAME);
+        PmemEmu::CreatePoolDir(path);
+        const int fd = open(path.c_str(), O_RDWR | O_CREAT, 0666);
+        if (fd < 0) return std::nullopt;
+        if (posix_fallocate(fd, 0, static_cast<off_t>(size)) != 0) {
+            close(fd);
+            return std::nullopt;
+        }
+        // Reserve room to place the file at the wanted alignment, then map it over the reservation
+        const std::size_t length = size + HUGE_1G + offset;
+        void* base = mmap(nullptr, length, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (base == MAP_FAILED) {
+            close(fd);
+            return std::nullopt;
+        }
+        auto* target = static_cast<std::byte*>(base) + (HUGE_1G - std::bit_cast<std::uintptr_t>(base) % HUGE_1G) % HUGE_1G + offset;
+        void* ptr = mmap(target, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+        close(fd);
+        if (ptr == MAP_FAILED) {
+            munmap(base, length);
+            return std::nullopt;
+        }
+        if (offset == 0) madvise(ptr, size, MADV_HUGEPAGE);    // tmpfs with shmem_enabled=advise, DAX ignores it
+        return Mapping{ static_cast<std::byte*>(ptr), size, base, length };
+    }
+    auto Map(Backing backing, std::size_t size) -> std::optional<Mapping> {
+        switch (backing) {
+            case Backing::Small: {
+                auto mapping = MapAnonymous(size, SMALL_PAGE_SIZE, 0);
+                if (mapping) madvise(mapping->Span().data(), size, MADV_NOHUGEPAGE);
+                return mapping;
+            }
+            case Backing::Thp: return MapThp(size);
+            case Backing::Huge2M: return MapAnonymous(size, HUGE_2M, MAP_HUGETLB | MAP_HUGE_2MB);
+            case Backing::Huge1G: return MapAnonymous(size, HUGE_1G, MAP_HUGETLB | MAP_HUGE_1GB);
+            case Backing::PoolSmall: return MapPool(size, SMALL_PAGE_SIZE);
+            case Backing::PoolHuge: return MapPool(size, 0);
+        }
+        return std::nullopt;
+    }
+
+    struct PageReport {
+        std::size_t pageKb{};    // KernelPageSize, 4 for THP and DAX, they map huge pages through pmd entries
+        std::size_t hugeKb{};    // Mapped by pmd entries, AnonHugePages, ShmemPmdMapped and FilePmdMapped
+    };
+    // From the /proc/self/smaps entry starting at addr
+    auto ReadPageReport(const void* addr) -> PageReport {
+        std::array<char, 2 * sizeof(std::uintptr_t) + 1> hex{};
+        const auto [end, ec] = std::to_chars(hex.data(), hex.data() + hex.size(), std::bit_cast<std::uintptr_t>(addr), 16);
+        const std::string start = std::string{ hex.data(), end } + "-";
+        std::ifstream smaps{ "/proc/self/smaps" };
+        PageReport report{};
+        bool inEntry = false;
+        for (std::string line{}; std::getline(smaps, line);) {
+            std::istringstream fields{ line };
+            std::string key{};
+            std::size_t kb{};
+            fields >> key;
+            // Entry headers start with the address range, fields with "Name:"
+            if (!key.ends_with(':')) {
+                if (inEntry) break;
+                inEntry = key.starts_with(start);
+                continue;
+            }
+            if (!inEntry) continue;
+            fields >> kb;
+            if (key == "KernelPageSize:") report.pageKb = kb;
+            else if (key == "AnonHugePages:" || key == "ShmemPmdMapped:" || key == "FilePmdMapped:") report.hugeKb += kb;
+        }
+        return report;
+    }
+
+    // Multiply-shift maps a 64-bit random value onto [0, lines) without a division
+    auto RandomLine(std::uint64_t& state, std::size_t lines) -> std::size_t {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return static_cast<std::size_t>((__extension__ static_cast<unsigned __int128>(state) * lines) >> 64);
+    }
+    enum class Access { SequentialRead, RandomRead, RandomWrite };
+    constexpr std::array<std::pair<std::string_view, Access>, 3> ACCESS_PATTERNS{ {
+        { "SequentialRead", Access::SequentialRead },
+        { "RandomRead", Access::RandomRead },
+        { "RandomWrite", Access::RandomWrite },
+    } };
+    // ACCESSES 8-byte accesses, one per line
+    auto Run(std::span<std::byte> range, Access access) -> void {
+        const std::size_t lines = range.size() / CACHE_LINE_SIZE;
+        std::uint64_t state = 0x9e3779b97f4a7c15;
+        std::uint64_t acc{};
+        for (auto i = 0UL; i < ACCESSES; ++i) {
+            std::uint64_t word{};
+            switch (access) {
+                case Access::SequentialRead:
+                    std::memcpy(&word, &range[(i % lines) * CACHE_LINE_SIZE], sizeof(word));
+                    acc += word;
+                    break;
+                case Access::RandomRead:
+                    std::memcpy(&word, &range[RandomLine(state, lines) * CACHE_LINE_SIZE], sizeof(word));
+                    acc += word;
+                    break;
+                case Access::RandomWrite: std::memcpy(&range[RandomLine(state, lines) * CACHE_LINE_SIZE], &i, sizeof(i)); break;
+            }
+        }
+        DoNotOptimize(acc);
+    }
+
+    auto ParseSize(int argc, char* argv[]) -> std::size_t {
+        constexpr std::string_view SIZE_ARG = "--size-mb=";
+        std::size_t sizeMb = DEFAULT_SIZE_MB;
+        for (const std::string_view arg : std::span{ argv, static_cast<std::size_t>(argc) }.subspan(1)) {
+            const std::string_view val = arg.substr(std::min(arg.size(), SIZE_ARG.size()));
+            const auto [ptr, ec] = std::from_chars(val.data(), val.data() + val.size(), sizeMb);
+            if (!arg.starts_with(SIZE_ARG) || ec != std::errc{} || ptr != val.data() + val.size() || sizeMb == 0) {
+                std::println(stdout, "usage: hugepage_bench [--size-mb=N]");
+                std::exit(EXIT_FAILURE);
+            }
+        }
+        return sizeMb * MB;
+    }
+}    // namespace
+
+auto main(int argc, char* argv[]) -> int {
+    const std::size_t size = ParseSize(argc, argv);
+    PinThisThreadToCore(BENCH_CPU);
+    const PerfCounter loadMisses{ DtlbMissEvent(PERF_COUNT_HW_CACHE_OP_READ) };
+    const PerfCounter storeMisses{ DtlbMissEvent(PERF_COUNT_HW_CACHE_OP_WRITE) };
+    const auto perAccess = [](std::optional<std::uint64_t> count) {
+        if (!count) return std::string{ "n/a" };
+        std::ostringstream os{};
+        os << std::fixed << std::setprecision(3) << static_cast<double>(*count) / static_cast<double>(ACCESSES);
+        return os.str();
+    };
+
+    for (const auto& [name, backing] : BACKINGS) {
+        auto mapping = Map(backing, size);
+        if (!mapping) {
+            std::println("{}: skipped, mapping failed: {}", name, std::strerror(errno));
+            continue;
+        }
+        const auto range = mapping->Span();
+        std::memset(range.data(), 1, range.size());    // Fault every page in before timing
+        const PageReport pages = ReadPageReport(range.data());
+        std::println("{}: page {} kB, {} kB in huge pmd mappings", name, pages.pageKb, pages.hugeKb);
+        for (const auto& [pattern, access] : ACCESS_PATTERNS) {
+            Run(range, access);    // Warm up, fills the TLB and caches as far as they reach
+            loadMisses.Start();
+            storeMisses.Start();
+            const auto begin = Clock::now();
+            Run(range, access);
+            const auto end = Clock::now();
+            const auto loads = loadMisses.Stop();
+            const auto stores = storeMisses.Stop();
+            std::println("{} {}: {:.1f} Mops/s, dTLB load misses/access {}, dTLB store misses/access {}", name, pattern,
+                         static_cast<double>(ACCESSES) / Nanos{ end - begin }.count() * 1e3, perAccess(loads), perAccess(stores));
+        }
+    }
+    return 0;
+}
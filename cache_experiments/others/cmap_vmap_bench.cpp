@@ -1,149 +1,353 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <barrier>
 #include <cassert>
+#include <charconv>
 #include <chrono>
 #include <cmath>
+#include <cstring>
 #include <filesystem>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <random>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include <memkind.h>
 #include <libpmemkv.hpp>
 
-#define MOUNT_DIR "/mnt/pmem0/myrontsa/"
-#define PERSIST_POOL_PATH_REL "pool_dir/persist_kvfile"
-#define VOLATILE_DIR_PATH_REL "pool_dir/volatile_dir/"
-constexpr uint64_t POOL_SIZE = MEMKIND_PMEM_MIN_SIZE;
-constexpr uint64_t WORKLOAD = 1LLU * powl(10, 6);
-constexpr auto PersistPoolPath = MOUNT_DIR PERSIST_POOL_PATH_REL;
+#include "PmemEmu.h"
+#include "TscClock.h"
 
-constexpr auto VolatileDirPath = VOLATILE_DIR_PATH_REL;
-auto KVPrint(std::string_view k, std::string_view v) -> int {
-    std::cout << "key: " << k.data() << " value: " << v.data() << std::endl;
-    return 0;
+// YCSB style driver over the pmemkv engines
+// ./cmap_vmap_bench --engines=cmap,vcmap,vsmap,stree --workloads=A,B,C,E,F --reads=copy,callback --threads=1,2,4,8 --value-size=100 --records=1000000 --ops=1000000
+
+#define POOL_DIR_REL "pool_dir/"
+constexpr uint64_t KEY_SIZE = 24;                  // "user" and a zero padded 20 digit index
+constexpr uint64_t POOL_OVERHEAD = 4;              // Pool bytes per payload byte, engine metadata and allocator slack
+constexpr double ZIPFIAN_THETA = 0.99;             // YCSB default skew
+constexpr std::array PERCENTILES{ 50.0, 90.0, 99.0, 99.9 };
+constexpr uint64_t MAX_SCAN_LENGTH = 100;    // YCSB E scans a uniform [1, 100] records
+
+using Clock = TscClock;    // Per operation samples, clock_gettime would dominate short reads
+using Nanos = std::chrono::nanoseconds;
+
+struct Options {
+    std::vector<std::string> engines{ "cmap", "vcmap", "vsmap", "stree" };
+    std::vector<std::string> workloads{ "A", "B", "C", "E", "F" };
+    std::vector<std::string> reads{ "copy", "callback" };
+    std::vector<uint64_t> threads{ 1, 2, 4, 8 };
+    uint64_t valueSize = 100;
+    uint64_t records = 1LLU * powl(10, 6);
+    uint64_t ops = 1LLU * powl(10, 6);
+};
+
+enum class OpType { Read, Update, ReadModifyWrite, Scan, Insert, Count };
+constexpr std::array<std::string_view, static_cast<std::size_t>(OpType::Count)> OP_NAMES{ "Read", "Update", "ReadModifyWrite", "Scan", "Insert" };
+
+// copy materializes every value into a reused std::string, callback consumes the string_view pmemkv hands out in place
+enum class ReadMode { Copy, Callback };
+auto ParseReadMode(std::string_view name) -> ReadMode;
+
+// Operation mix of the YCSB core workloads, fractions add up to 1
+struct Workload {
+    std::string_view name;
+    double read;
+    double update;
+    double readModifyWrite;
+    double scan;
+    double insert;
+};
+constexpr std::array WORKLOADS{
+    Workload{ "A", 0.50, 0.50, 0.00, 0.00, 0.00 },    // Update heavy
+    Workload{ "B", 0.95, 0.05, 0.00, 0.00, 0.00 },    // Read mostly
+    Workload{ "C", 1.00, 0.00, 0.00, 0.00, 0.00 },    // Read only
+    Workload{ "E", 0.00, 0.00, 0.00, 0.95, 0.05 },    // Short ranges, sorted engines only
+    Workload{ "F", 0.50, 0.00, 0.50, 0.00, 0.00 },    // Read-modify-write
+};
+auto PickOp(const Workload& workload, double pick) -> OpType {
+    if ((pick -= workload.read) < 0) return OpType::Read;
+    if ((pick -= workload.update) < 0) return OpType::Update;
+    if ((pick -= workload.readModifyWrite) < 0) return OpType::ReadModifyWrite;
+    if ((pick -= workload.scan) < 0) return OpType::Scan;
+    return OpType::Insert;
 }
 
-class KVOperations {
-public:
-    struct KVPair {
-        std::string key;
-        std::string value;
-    };
-    using DB = pmem::kv::db;
+std::atomic<uint64_t> Sink{};    // Callback reads fold the values they see here, so the reads are not optimized away
 
-    KVOperations(const std::string& path, const std::string& engine)
-        : kv{ std::make_unique<DB>() } {
-        assert(engine == "cmap" || engine == "vcmap" || engine == "vsmap");
-        pmem::kv::config cfg;
-        if (cfg.put_string("path", path) != pmem::kv::status::OK) {
-            std::cerr << pmemkv_errormsg() << std::endl;
-            assert(false);
-            exit(1);
-        }
-        if (cfg.put_uint64("size", POOL_SIZE) != pmem::kv::status::OK) {
-            std::cerr << pmemkv_errormsg() << std::endl;
-            assert(false);
-            exit(1);
-        }
-        if (engine == "cmap") {
-            const bool fileMissing = !std::filesystem::exists(path);
-            if (cfg.put_uint64("create_if_missing", fileMissing) != pmem::kv::status::OK) {
-                std::cerr << pmemkv_errormsg() << std::endl;
-                assert(false);
-                exit(1);
-            }
-        }
-        if (kv->open(engine, std::move(cfg)) != pmem::kv::status::OK) {
-            std::cerr << pmemkv_errormsg() << std::endl;
-            assert(false);
-            exit(1);
+[[noreturn]] auto Fail(std::string_view what, std::string_view val) -> void {
+    std::cerr << what << " '" << val << "'" << std::endl;
+    assert(false);
+    exit(1);
+}
+
+// Fixed size keys back to back in one allocation, no per-key heap strings
+class KeyArena {
+public:
+    explicit KeyArena(uint64_t records)
+        : arena(records * KEY_SIZE, '0') {
+        for (auto i = 0LLU; i < records; ++i) {
+            char* key = &arena[i * KEY_SIZE];
+            std::memcpy(key, "user", 4);
+            char digits[KEY_SIZE]{};
+            const auto [end, ec] = std::to_chars(std::begin(digits), std::end(digits), i);
+            assert(ec == std::errc{});
+            std::memcpy(key + KEY_SIZE - (end - digits), digits, static_cast<std::size_t>(end - digits));
         }
     }
-    auto PrepareKeys() -> void {
-        std::generate(std::begin(pairs), std::end(pairs), [c = 0LLU]() mutable {
-            c += 1;
-            return KVPair{ "key" + std::to_string(c), "value" + std::to_string(c) };
-        });
+    auto operator[](uint64_t i) const -> std::string_view { return { &arena[i * KEY_SIZE], KEY_SIZE }; }
+
+private:
+    std::vector<char> arena{};
+};
+
+// YCSB ZipfianGenerator (Gray et al., Quickly Generating Billion-Record Synthetic Databases), ranks scrambled over the key space
+class Zipfian {
+public:
+    Zipfian(uint64_t _items, double _theta)
+        : items{ _items }, theta{ _theta }, zetaN{ Zeta(_items, _theta) } {
+        alpha = 1.0 / (1.0 - theta);
+        eta = (1.0 - std::pow(2.0 / static_cast<double>(items), 1.0 - theta)) / (1.0 - Zeta(2, theta) / zetaN);
     }
-    auto Run() -> void {
-        pmem::kv::status ok{};
-        for (const auto& [key, value] : pairs) {
-            ok = kv->put(key, value);
-            assert(ok == pmem::kv::status::OK);
-            ok = kv->exists(key);
-            assert(ok == pmem::kv::status::OK);
-        }
+    auto operator()(std::mt19937_64& gen) const -> uint64_t { return Scramble(Rank(gen)) % items; }
+
+private:
+    static auto Zeta(uint64_t n, double theta) -> double {
+        double sum = 0;
+        for (auto i = 1LLU; i <= n; ++i) sum += 1.0 / std::pow(static_cast<double>(i), theta);
+        return sum;
     }
-    auto CheckRecover() -> void {
-        std::cout << "Not Recovered Keys:\n";
-        for (const auto& [key, value] : pairs) {
-            const auto ok = kv->exists(key);
-            if (ok != pmem::kv::status::OK) std::cout << key << " ";
-        }
-        std::cout << "\n";
+    auto Rank(std::mt19937_64& gen) const -> uint64_t {
+        const double u = std::uniform_real_distribution<double>{ 0.0, 1.0 }(gen);
+        const double uz = u * zetaN;
+        if (uz < 1.0) return 0;
+        if (uz < 1.0 + std::pow(0.5, theta)) return 1;
+        return static_cast<uint64_t>(static_cast<double>(items) * std::pow(eta * u - eta + 1.0, alpha));
     }
-    auto Print() const -> void {
-        kv->get_all(KVPrint);
+    // FNV-1a, spreads the hot ranks instead of clustering them at the smallest keys
+    static auto Scramble(uint64_t rank) -> uint64_t {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (auto i = 0; i < 8; ++i) {
+            hash ^= rank & 0xff;
+            hash *= 0x100000001b3ULL;
+            rank >>= 8;
+        }
+        return hash;
     }
+    uint64_t items{};
+    double theta{};
+    double zetaN{};
+    double alpha{};
+    double eta{};
+};
 
-private:
-    std::unique_ptr<DB> kv{};
-    std::vector<KVPair> pairs{ WORKLOAD };
+// Per thread latencies, merged after the run
+struct Latencies {
+    std::array<std::vector<Nanos::rep>, static_cast<std::size_t>(OpType::Count)> ops{};
 };
-KVOperations PersistKv{ PersistPoolPath, "cmap" };
-KVOperations VolatileKv{ VolatileDirPath, "vcmap" };
 
-class TimeIt {
+class KVOperations {
 public:
-    TimeIt(std::string _id) : id{ std::move(_id) }, begin{ std::chrono::steady_clock::now() } {}
-    ~TimeIt() {
-        const auto end = std::chrono::steady_clock::now();
-        std::cout << id << ": " << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count() << " ms\n";
+    using DB = pmem::kv::db;
+
+    KVOperations(const std::string& _engine, uint64_t poolSize)
+        : kv{ std::make_unique<DB>() }, engine{ _engine }, concurrent{ _engine == "cmap" || _engine == "vcmap" }, sorted{ _engine == "vsmap" || _engine == "stree" } {
+        if (engine != "cmap" && engine != "vcmap" && engine != "vsmap" && engine != "stree") Fail("unknown engine", engine);
+        const bool persistent = engine == "cmap" || engine == "stree";
+        // Persistent engines map a pool file, volatile ones a memkind directory
+        const std::string path = PmemEmu::PoolPath(std::string{ POOL_DIR_REL } + (persistent ? engine + "_kvfile" : "volatile_dir"));
+        PmemEmu::CreatePoolDir(path);
+        if (persistent) std::filesystem::remove(path);
+        else std::filesystem::create_directories(path);
+        pmem::kv::config cfg;
+        if (cfg.put_string("path", path) != pmem::kv::status::OK) Fail(pmemkv_errormsg(), engine);
+        if (cfg.put_uint64("size", std::max<uint64_t>(poolSize, MEMKIND_PMEM_MIN_SIZE)) != pmem::kv::status::OK) Fail(pmemkv_errormsg(), engine);
+        if (persistent && cfg.put_uint64("create_if_missing", 1) != pmem::kv::status::OK) Fail(pmemkv_errormsg(), engine);
+        if (kv->open(engine, std::move(cfg)) != pmem::kv::status::OK) Fail(pmemkv_errormsg(), engine);
     }
+    ~KVOperations() { kv->close(); }
+    KVOperations(const KVOperations&) = delete;
+    auto operator=(const KVOperations&) -> KVOperations& = delete;
 
-private:
-    std::string id{};
-    std::chrono::time_point<std::chrono::steady_clock> begin{};
+    // vsmap and stree are not thread safe, their clients serialize on a lock as a single-writer tier would
+    template<typename F> auto Apply(F&& op) -> pmem::kv::status {
+        if (concurrent) return op(*kv);
+        std::scoped_lock lock{ mutex };
+        return op(*kv);
+    }
 
-public:
-    TimeIt(const TimeIt&) = delete;
-    TimeIt(const TimeIt&&) noexcept = delete;
-    auto operator=(const TimeIt&) -> TimeIt& = delete;
-    auto operator=(const TimeIt&&) noexcept -> TimeIt& = delete;
-};
+    auto Load(const KeyArena& keys, uint64_t records, uint64_t valueSize, uint64_t threads) -> void {
+        nextInsert = records;
+        std::vector<std::jthread> workers{};
+        for (auto tid = 0LLU; tid < threads; ++tid)
+            workers.emplace_back([this, &keys, records, valueSize, tid, threads]() {
+                const std::string value(valueSize, static_cast<char>('a' + tid % 26));
+                for (auto i = tid; i < records; i += threads)
+                    if (Apply([&](DB& db) { return db.put(keys[i], value); }) != pmem::kv::status::OK) Fail("load put", keys[i]);
+            });
+    }
 
-auto RunBenchAll() -> void {
-    PersistKv.PrepareKeys();
-    VolatileKv.PrepareKeys();
+    auto Run(const Workload& workload, ReadMode readMode, const KeyArena& keys, const Zipfian& zipfian, const Options& options, uint64_t threads) -> void {
+        if (workload.scan > 0 && !sorted) {
+            std::cout << engine << " " << workload.name << " " << (readMode == ReadMode::Copy ? "copy" : "callback") << ": skipped, unsorted engine has no range scan\n";
+            return;
+        }
+        std::vector<Latencies> latencies(threads);
+        std::barrier clockBarrier{ static_cast<std::ptrdiff_t>(threads) };
+        Clock::time_point begin{}, end{};
+        {
+            std::vector<std::jthread> workers{};
+            for (auto tid = 0LLU; tid < threads; ++tid)
+                workers.emplace_back([&, tid]() {
+                    std::mt19937_64 gen{ std::random_device{}() };
+                    std::uniform_real_distribution<double> mix{ 0.0, 1.0 };
+                    std::string value(options.valueSize, 'u');
+                    std::string buffer{};    // Reused by every copying read, no allocation once grown
+                    uint64_t seen = 0;
+                    std::uniform_int_distribution<uint64_t> scanLength{ 1, MAX_SCAN_LENGTH };
+                    const uint64_t ops = options.ops / threads;
+                    for (auto& op : latencies[tid].ops) op.reserve(ops);
+                    clockBarrier.arrive_and_wait();
+                    if (tid == 0) begin = Clock::now();
+                    for (auto i = 0LLU; i < ops; ++i) {
+                        const OpType type = PickOp(workload, mix(gen));
+                        const std::string_view key = type == OpType::Insert ? keys[nextInsert.fetch_add(1, std::memory_order_relaxed)] : keys[zipfian(gen)];
+                        const uint64_t length = type == OpType::Scan ? scanLength(gen) : 0;
+                        const auto opBegin = Clock::now();
+                        pmem::kv::status ok{};
+                        switch (type) {
+                            case OpType::Read:
+                                if (readMode == ReadMode::Copy) ok = Apply([&](DB& db) { return db.get(key, &buffer); });
+                                else ok = Apply([&](DB& db) { return db.get(key, [&seen](std::string_view v) { seen += v.size() + static_cast<unsigned char>(v.front()); }); });
+                                break;
+                            case OpType::Scan:
+                                ok = Apply([&](DB& db) {
+                                    uint64_t left = length;
+                                    return db.get_above(key, [&](std::string_view, std::string_view v) {
+                                        if (readMode == ReadMode::Copy) buffer.assign(v);
+                                        else seen += v.size() + static_cast<unsigned char>(v.front());
+                                        return --left == 0 ? 1 : 0;    // Non-zero stops the scan
+                                    });
+                                });
+                                if (ok == pmem::kv::status::STOPPED_BY_CB) ok = pmem::kv::status::OK;
+                                break;
+                            case OpType::Insert: ok = Apply([&](DB& db) { return db.put(key, value); }); break;
+                            case OpType::Update: ok = Apply([&](DB& db) { return db.put(key, value); }); break;
+                            case OpType::ReadModifyWrite:
+                                ok = Apply([&](DB& db) {
+                                    const auto status = db.get(key, &buffer);
+                                    if (status != pmem::kv::status::OK) return status;
+                                    buffer[0] = static_cast<char>(buffer[0] + 1);
+                                    return db.put(key, buffer);
+                                });
+                                break;
+                            case OpType::Count: assert(false); break;
+                        }
+                        const auto opEnd = Clock::now();
+                        if (ok != pmem::kv::status::OK) Fail("operation failed", key);
+                        latencies[tid].ops[static_cast<std::size_t>(type)].push_back(std::chrono::duration_cast<Nanos>(opEnd - opBegin).count());
+                    }
+                    clockBarrier.arrive_and_wait();
+                    if (tid == 0) end = Clock::now();
+                    Sink.fetch_add(seen, std::memory_order_relaxed);
+                });
+        }
+        Report(workload, readMode, latencies, end - begin, threads);
+    }
 
-    {
-        TimeIt _{ "Persistent KV Run" };
-        PersistKv.Run();
+private:
+    auto Report(const Workload& workload, ReadMode readMode, const std::vector<Latencies>& latencies, Clock::duration duration, uint64_t threads) const -> void {
+        uint64_t total = 0;
+        for (const auto& thread : latencies)
+            for (const auto& op : thread.ops) total += op.size();
+        const double seconds = std::chrono::duration<double>(duration).count();
+        std::cout << engine << " " << workload.name << " " << (readMode == ReadMode::Copy ? "copy" : "callback") << " " << threads << " threads: " << static_cast<uint64_t>(static_cast<double>(total) / seconds) << " ops/s\n";
+        for (auto type = 0UL; type < OP_NAMES.size(); ++type) {
+            std::vector<Nanos::rep> merged{};
+            for (const auto& thread : latencies) merged.insert(merged.end(), thread.ops[type].begin(), thread.ops[type].end());
+            if (merged.empty()) continue;
+            std::ranges::sort(merged);
+            std::cout << "    " << OP_NAMES[type] << " " << merged.size() << " ops";
+            for (const double p : PERCENTILES) {
+                const auto idx = static_cast<std::size_t>(p / 100.0 * static_cast<double>(merged.size() - 1));
+                std::cout << " p" << p << " " << merged[idx] << "ns";
+            }
+            std::cout << " max " << merged.back() << "ns\n";
+        }
     }
-    // PersistKv.Print();
 
-    {
-        TimeIt _{ "Volatile KV Run" };
-        VolatileKv.Run();
+    std::unique_ptr<DB> kv{};
+    std::string engine{};
+    bool concurrent{};
+    bool sorted{};
+    std::mutex mutex{};
+    std::atomic<uint64_t> nextInsert{};    // Next unloaded key of the arena, taken by Insert
+};
+
+auto Split(std::string_view str) -> std::vector<std::string> {
+    std::vector<std::string> tokens{};
+    for (auto pos = 0UL; pos <= str.size();) {
+        const auto next = std::min(str.find(',', pos), str.size());
+        tokens.emplace_back(str.substr(pos, next - pos));
+        pos = next + 1;
     }
-    // VolatileKv.Print();
+    return tokens;
 }
-
-auto RecoverAll() -> void {
-    PersistKv.PrepareKeys();
-    VolatileKv.PrepareKeys();
-    {
-        TimeIt _{ "Persistent KV Recovery" };
-        PersistKv.CheckRecover();
+auto ParseNumber(std::string_view str) -> uint64_t {
+    uint64_t val{};
+    const auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), val);
+    if (ec != std::errc{} || ptr != str.data() + str.size() || val == 0) Fail("expected a positive number", str);
+    return val;
+}
+auto ParseArgs(int argc, char* argv[]) -> Options {
+    Options options{};
+    for (auto i = 1; i < argc; ++i) {
+        const std::string_view arg{ argv[i] };
+        const auto eq = arg.find('=');
+        if (!arg.starts_with("--") || eq == std::string_view::npos) Fail("expected --key=values", arg);
+        const std::string_view key = arg.substr(2, eq - 2), val = arg.substr(eq + 1);
+        if (key == "engines") options.engines = Split(val);
+        else if (key == "workloads") options.workloads = Split(val);
+        else if (key == "reads") options.reads = Split(val);
+        else if (key == "threads") {
+            options.threads.clear();
+            for (const auto& t : Split(val)) options.threads.push_back(ParseNumber(t));
+        } else if (key == "value-size") options.valueSize = ParseNumber(val);
+        else if (key == "records") options.records = ParseNumber(val);
+        else if (key == "ops") options.ops = ParseNumber(val);
+        else Fail("unknown option", key);
     }
-    // {
-    //     TimeIt _{ "Volatile KV Recovery" };
-    //     VolatileKv.CheckRecover();
-    // }
+    for (const auto& name : options.workloads)
+        if (std::ranges::none_of(WORKLOADS, [&name](const auto& w) { return w.name == name; })) Fail("unknown workload", name);
+    for (const auto& name : options.reads) ParseReadMode(name);
+    return options;
+}
+auto ParseReadMode(std::string_view name) -> ReadMode {
+    if (name == "copy") return ReadMode::Copy;
+    if (name == "callback") return ReadMode::Callback;
+    Fail("unknown read mode", name);
 }
 
-auto main() -> int {
-    RunBenchAll();
-    RecoverAll();
+auto main(int argc, char* argv[]) -> int {
+    PmemEmu::Init();
+    const Options options = ParseArgs(argc, argv);
+    // Spare keys past records for the inserts of every run
+    const KeyArena keys{ options.records + options.ops * options.workloads.size() * options.reads.size() };
+    const Zipfian zipfian{ options.records, ZIPFIAN_THETA };
+    const uint64_t poolSize = POOL_OVERHEAD * options.records * (KEY_SIZE + options.valueSize);
+    for (const auto& engine : options.engines) {
+        for (const auto threads : options.threads) {
+            // Fresh store per thread count, so every run starts from the same loaded state
+            KVOperations kv{ engine, poolSize };
+            kv.Load(keys, options.records, options.valueSize, threads);
+            for (const auto& name : options.workloads)
+                for (const auto& read : options.reads) kv.Run(*std::ranges::find(WORKLOADS, name, &Workload::name), ParseReadMode(read), keys, zipfian, options, threads);
+        }
+    }
     return 0;
 }
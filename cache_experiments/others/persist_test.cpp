@@ -1,10 +1,25 @@
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <cmath>
 #include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <string>
 #include <thread>
+#include <utility>
+#include <vector>
 
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <libpmemobj.h>
 #include <libpmemobj++/make_persistent_atomic.hpp>
 #include <libpmemobj++/p.hpp>
 #include <libpmemobj++/persistent_ptr.hpp>
@@ -13,17 +28,21 @@
 #include <libpmemobj++/pool.hpp>
 #include <libpmemobj++/transaction.hpp>
 
-#define MOUNT_DIR "/mnt/pmem0/myrontsa/"
+#include "PmemEmu.h"
+
 #define POOL_PATH_REL "pool_dir/pool"
-constexpr uint64_t POOL_SIZE = PMEMOBJ_MIN_POOL;
-constexpr uint64_t WORKLOAD = 1LU * 1'0;
-constexpr auto PoolPath = MOUNT_DIR POOL_PATH_REL;
+constexpr uint64_t POOL_SIZE = PMEMOBJ_MIN_POOL * 64;    // Recovery time grows with the pool
+constexpr uint64_t WORKLOAD = 1LU * 1'000'000;
+constexpr uint64_t CRASH_ROUNDS = 20;
+constexpr uint64_t GROUP_SIZES[] = { 1, 4, 16, 64, 256, 1024 };    // Updates per commit of the group commit strategies
+const std::string PoolPath = PmemEmu::PoolPath(POOL_PATH_REL);
 
 struct RootType {
     pmem::obj::p<uint64_t> counter1;
     pmem::obj::p<uint64_t> counter2;
     pmem::obj::p<uint64_t> counter3;
     pmem::obj::persistent_ptr<uint64_t> ptr;
+    pmem::obj::p<uint64_t> counter4;
 };
 
 constexpr const char* PoolLayout = "pool";
@@ -31,82 +50,247 @@ pmem::obj::pool<RootType> Pool{};
 pmem::obj::persistent_ptr<RootType> RootPtr{};
 
 using Clock = std::chrono::steady_clock;
-using Seconds = std::chrono::seconds;
-using TimePoint = std::chrono::time_point<Clock>;
-
-void KillTask() {
-    bool done = false;
-    const auto killTimePoint = TimePoint(Clock::now() + Seconds(4));
-    while (!done) {
-        const auto now = Clock::now();
-        std::this_thread::sleep_until(killTimePoint);
-        if (now >= killTimePoint) {
-            std::abort();
-            done = true;
-        }
-    }
-}
+using Micros = std::chrono::microseconds;
+constexpr auto KILL_WINDOW = Micros(20'000);    // SIGKILL lands uniformly in [0, KILL_WINDOW) after the child starts its workload
 
-void RecoverPrintReset() {
-    std::cout << "VolatileWriteMaybeFlush: " << RootPtr->counter1 << "\n";
-    std::cout << "VolatileWriteForceFlush: " << RootPtr->counter2 << "\n";
-    std::cout << "AtomicWriteTransaction: " << RootPtr->counter3 << "\n";
-    if (RootPtr->ptr) std::cout << "AtomicWriteAllocation: " << *(RootPtr->ptr) << "\n";
-    RootPtr->counter1 = 0LU;
-    RootPtr->counter2 = 0LU;
-    RootPtr->counter3 = 0LU;
-    pmem::obj::make_persistent_atomic<uint64_t>(Pool, RootPtr->ptr, 0U);
+// Shared with the crashing child, the parent reads it after the kill
+struct Progress {
+    std::atomic<bool> running;
+    std::atomic<uint64_t> issued;    // Updates the child started, raised before each update so a kill never leaves one above it
+    std::atomic<uint64_t> acked;     // Updates the child committed, the in-flight commit excluded
+};
+Progress* SharedProgress{};    // nullptr outside crash rounds
+
+// Called before update i touches the pool, the fence keeps the compiler from sinking the store below the update
+void Issue(uint64_t i) {
+    if (!SharedProgress) return;
+    SharedProgress->issued.store(i + 1, std::memory_order_release);
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+void Ack(uint64_t i) {
+    if (SharedProgress) SharedProgress->acked.store(i + 1, std::memory_order_release);
 }
 
-void VolatileWriteMaybeFlush() {
-    for (auto i = 0LU; i < WORKLOAD; ++i) {
+void VolatileWriteMaybeFlush(uint64_t ops) {
+    for (auto i = 0LU; i < ops; ++i) {
+        Issue(i);
         RootPtr->counter1 += 1;
+        Ack(i);
     }
 }
 
-void VolatileWriteForceFlush() {
-    for (auto i = 0LU; i < WORKLOAD; ++i) {
+void VolatileWriteForceFlush(uint64_t ops) {
+    for (auto i = 0LU; i < ops; ++i) {
+        Issue(i);
         RootPtr->counter2 += 1LU;
-        Pool.persist(RootPtr->counter2);
+        PmemEmu::Persist(Pool, &RootPtr->counter2, sizeof(RootPtr->counter2));
+        Ack(i);
     }
 }
 
-void AtomicWriteTransaction() {
-    for (auto i = 0LU; i < WORKLOAD; ++i) {
+void AtomicWriteTransaction(uint64_t ops) {
+    for (auto i = 0LU; i < ops; ++i) {
+        Issue(i);
         pmem::obj::transaction::run(Pool, []() {
             RootPtr->counter3 += 1LU;
         });
+        Ack(i);
+    }
+}
+
+// Updates accumulate in volatile memory, every group updates are applied in one transaction
+void GroupCommitTransaction(uint64_t ops, uint64_t group) {
+    uint64_t pending = 0;
+    for (auto i = 0LU; i < ops; ++i) {
+        ++pending;
+        Issue(i);
+        if (pending < group) continue;
+        pmem::obj::transaction::run(Pool, [pending]() {
+            RootPtr->counter4 += pending;
+        });
+        pending = 0;
+        Ack(i);
+    }
+}
+
+// As GroupCommitTransaction, the 8-byte store of the running total is failure atomic and is its own redo log entry
+void GroupCommitPersist(uint64_t ops, uint64_t group) {
+    uint64_t total = RootPtr->counter4;
+    for (auto i = 0LU; i < ops; ++i) {
+        ++total;
+        Issue(i);
+        if (total % group != 0) continue;
+        RootPtr->counter4 = total;
+        PmemEmu::Persist(Pool, &RootPtr->counter4, sizeof(RootPtr->counter4));
+        Ack(i);
     }
 }
 
-void AtomicWriteAllocation() {
-    for (auto i = 0LU; i < WORKLOAD; ++i) {
+void AtomicWriteAllocation(uint64_t ops) {
+    for (auto i = 0LU; i < ops; ++i) {
+        Issue(i);
         pmem::obj::make_persistent_atomic<uint64_t>(Pool, RootPtr->ptr, i);
         pmem::obj::delete_persistent_atomic<uint64_t>(RootPtr->ptr);
+        Ack(i);
+    }
+}
+
+struct Report {
+    double opsPerSec{};
+    std::vector<Micros> checkTimes{};
+    std::vector<Micros> openTimes{};
+    uint64_t violations{};
+    uint64_t maxLost{};    // Largest gap between issued and recovered updates
+};
+
+// A SIGKILL loses at most the in-flight commit of group updates, never a committed one, and never splits a group
+bool CounterInvariant(uint64_t counter, uint64_t group, const Progress& progress, Report& report) {
+    const uint64_t issued = progress.issued, acked = progress.acked;
+    if (issued >= counter) report.maxLost = std::max(report.maxLost, issued - counter);
+    return acked <= counter && counter <= acked + group && counter <= issued && counter % group == 0;
+}
+// Only the in-flight object may be live, holding its operation index, anything else leaked
+bool CheckAllocation(const Progress& progress) {
+    uint64_t live = 0;
+    for (PMEMoid oid = pmemobj_first(Pool.handle()); !OID_IS_NULL(oid); oid = pmemobj_next(oid)) ++live;
+    if (!RootPtr->ptr) return live == 0;
+    return live == 1 && *RootPtr->ptr == progress.acked;
+}
+
+struct Strategy {
+    std::string name;
+    std::function<void(uint64_t ops)> run;
+    std::function<bool(const Progress& progress, Report& report)> check;
+};
+std::vector<Strategy> MakeStrategies() {
+    std::vector<Strategy> strategies{
+        { "VolatileWriteMaybeFlush", VolatileWriteMaybeFlush, [](const Progress& progress, Report& report) { return CounterInvariant(RootPtr->counter1, 1, progress, report); } },
+        { "VolatileWriteForceFlush", VolatileWriteForceFlush, [](const Progress& progress, Report& report) { return CounterInvariant(RootPtr->counter2, 1, progress, report); } },
+        { "AtomicWriteTransaction", AtomicWriteTransaction, [](const Progress& progress, Report& report) { return CounterInvariant(RootPtr->counter3, 1, progress, report); } },
+        { "AtomicWriteAllocation", AtomicWriteAllocation, [](const Progress& progress, Report&) { return CheckAllocation(progress); } },
+    };
+    const auto checkGroup = [](uint64_t group) {
+        return [group](const Progress& progress, Report& report) { return CounterInvariant(RootPtr->counter4, group, progress, report); };
+    };
+    for (const uint64_t group : GROUP_SIZES) {
+        strategies.push_back({ "GroupCommitTransaction" + std::to_string(group), [group](uint64_t ops) { GroupCommitTransaction(ops, group); }, checkGroup(group) });
+        strategies.push_back({ "GroupCommitPersist" + std::to_string(group), [group](uint64_t ops) { GroupCommitPersist(ops, group); }, checkGroup(group) });
+    }
+    return strategies;
+}
+
+void OpenPool() {
+    Pool = pmem::obj::pool<RootType>::open(PoolPath, PoolLayout);
+    RootPtr = Pool.root();
+}
+
+void Reset() {
+    pmem::obj::transaction::run(Pool, []() {
+        RootPtr->counter1 = 0LU;
+        RootPtr->counter2 = 0LU;
+        RootPtr->counter3 = 0LU;
+        RootPtr->counter4 = 0LU;
+    });
+    if (RootPtr->ptr) pmem::obj::delete_persistent_atomic<uint64_t>(RootPtr->ptr);
+}
+
+double Throughput(const Strategy& strategy) {
+    OpenPool();
+    Reset();
+    const auto begin = Clock::now();
+    strategy.run(WORKLOAD);
+    const auto end = Clock::now();
+    Pool.close();
+    return static_cast<double>(WORKLOAD) / std::chrono::duration<double>(end - begin).count();
+}
+
+// The child runs the strategy until killed, the parent recovers the pool as a restarted process would
+void CrashRound(const Strategy& strategy, std::mt19937_64& gen, Report& report) {
+    SharedProgress->running = false;
+    SharedProgress->issued = 0;
+    SharedProgress->acked = 0;
+    const pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        OpenPool();
+        SharedProgress->running = true;
+        strategy.run(std::numeric_limits<uint64_t>::max());
+        _exit(EXIT_SUCCESS);
+    }
+    // A child that dies before running, e.g. OpenPool throws, would leave the parent spinning forever
+    while (!SharedProgress->running) {
+        int status{};
+        if (waitpid(pid, &status, WNOHANG) == pid) {
+            std::cout << strategy.name << ": child exited before running, ";
+            if (WIFEXITED(status)) std::cout << "status " << WEXITSTATUS(status) << "\n";
+            else std::cout << "signal " << WTERMSIG(status) << "\n";
+            std::cout.flush();
+            std::abort();
+        }
+        std::this_thread::yield();
+    }
+    std::uniform_int_distribution<Micros::rep> killPoint{ 0, KILL_WINDOW.count() - 1 };
+    std::this_thread::sleep_for(Micros(killPoint(gen)));
+    kill(pid, SIGKILL);
+    int status{};
+    waitpid(pid, &status, 0);
+
+    const auto checkBegin = Clock::now();
+    const int isConsistent = pmem::obj::pool<RootType>::check(PoolPath, PoolLayout);
+    const auto openBegin = Clock::now();
+    OpenPool();
+    const auto openEnd = Clock::now();
+    report.checkTimes.push_back(std::chrono::duration_cast<Micros>(openBegin - checkBegin));
+    report.openTimes.push_back(std::chrono::duration_cast<Micros>(openEnd - openBegin));
+    if (isConsistent != 1 || !strategy.check(*SharedProgress, report)) {
+        ++report.violations;
+        std::cout << strategy.name << ": invariant violated, consistent " << isConsistent << " issued " << SharedProgress->issued << " acked " << SharedProgress->acked
+                  << " counters " << RootPtr->counter1 << " " << RootPtr->counter2 << " " << RootPtr->counter3 << " " << RootPtr->counter4 << "\n";
     }
+    Reset();
+    Pool.close();
+}
+
+Micros Mean(const std::vector<Micros>& times) { return std::accumulate(times.begin(), times.end(), Micros{}) / static_cast<Micros::rep>(times.size()); }
+
+void PrintReport(const Strategy& strategy, const Report& report) {
+    std::cout << strategy.name << ": " << static_cast<uint64_t>(report.opsPerSec) << " ops/s"
+              << ", recovery check " << Mean(report.checkTimes).count() << "us (max " << std::ranges::max(report.checkTimes).count() << "us)"
+              << ", open " << Mean(report.openTimes).count() << "us (max " << std::ranges::max(report.openTimes).count() << "us)"
+              << ", lost updates max " << report.maxLost << ", " << report.violations << "/" << CRASH_ROUNDS << " invariant violations\n";
 }
 
 int main() {
+    PmemEmu::Init();
     try {
         int isConsistent = pmem::obj::pool<RootType>::check(PoolPath, PoolLayout);
         if (isConsistent > 0)
             Pool = pmem::obj::pool<RootType>::open(PoolPath, PoolLayout);
-        else if (isConsistent < 0)
-            Pool = pmem::obj::pool<RootType>::create(PoolPath, PoolLayout, PMEMOBJ_MIN_POOL);
-        else {
+        else if (isConsistent < 0) {
+            PmemEmu::CreatePoolDir(PoolPath);
+            Pool = pmem::obj::pool<RootType>::create(PoolPath, PoolLayout, POOL_SIZE);
+        } else {
             std::cout << "IsConsistent: " << isConsistent << "\n";
             assert(false);
         }
-        RootPtr = Pool.root();
+        Pool.close();
 
-        // RecoverPrintReset();
+        void* shared = mmap(nullptr, sizeof(Progress), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        assert(shared != MAP_FAILED);
+        SharedProgress = new (shared) Progress{};
+        std::mt19937_64 gen{ std::random_device{}() };
 
-        // std::jthread killThread(KillTask);
-
-        // VolatileWriteMaybeFlush();
-        // VolatileWriteForceFlush();
-        // AtomicWriteTransaction();
-        // Atomi
+        for (const auto& strategy : MakeStrategies()) {
+            Report report{};
+            {
+                Progress* crashProgress = std::exchange(SharedProgress, nullptr);    // No acks while measuring throughput
+                report.opsPerSec = Throughput(strategy);
+                SharedProgress = crashProgress;
+            }
+            for (auto round = 0LU; round < CRASH_ROUNDS; ++round) CrashRound(strategy, gen, report);
+            PrintReport(strategy, report);
+        }
+        munmap(shared, sizeof(Progress));
 
     } catch (const pmem::pool_error& e) {
         std::cout << e.what() << "\n";
@@ -7,10 +7,19 @@ import matplotlib.pyplot as plt
 import seaborn as sns
 
 DATA_PATH = 'Traces.csv'
+BANDWIDTH_PATH = 'RooflineBandwidth.csv'
+LATENCY_PATH = 'RooflineLatency.csv'
 NUM_OPS = 2 * 10**7
 
 DROP_MEASUREMENTS = 5
 
+UNITS_PER_SECOND = {
+    'seconds': 1,
+    'milliseconds': 10**3,
+    'microseconds': 10**6,
+    'nanoseconds': 10**9,
+}
+
 
 def drop_measurements(df):
     '''
@@ -30,7 +39,7 @@ def to_throughput(df, headers, num_ops):
     '''
     throughput_header = 'Mops/second'
     num_million_ops = num_ops / 10**6
-    seconds = df['milliseconds'] / 1000
+    seconds = df[headers[1]] / UNITS_PER_SECOND[headers[1]]
     df[throughput_header] = num_million_ops / seconds
     headers[2] = throughput_header
     return df, headers
@@ -54,6 +63,24 @@ def pointplot(df, name_label, x_label, y_label):
     # plt.show()
 
 
+def roofline():
+    '''
+    roofline output, bandwidth against threads and latency against working set size
+    '''
+    bandwidth = pd.read_csv(BANDWIDTH_PATH)
+    latency = pd.read_csv(LATENCY_PATH)
+    sns.set_theme()
+    sns.set_context('paper')
+    _, (left, right) = plt.subplots(1, 2, figsize=(12, 4))
+    sns.lineplot(data=bandwidth, x='threads', y='GB/s',
+                 hue='kernel', style='memory', markers=True, ax=left)
+    sns.lineplot(data=latency, x='bytes', y='ns',
+                 hue='memory', style='threads', markers=True, ax=right)
+    right.set_xscale('log', base=2)
+    plt.savefig('roofline.pdf', format='pdf')
+    # plt.show()
+
+
 def pre_process(data_path):
     df = pd.read_csv(data_path, skipinitialspace=True, comment='#')
     headers = df.columns.to_list()
@@ -65,13 +92,16 @@ def pre_process(data_path):
 def parse_args():
     parser = argparse.ArgumentParser()
     parser.add_argument('plot_type', nargs='?', choices=[
-                        'barplot', 'pointplot'], default='barplot')
+                        'barplot', 'pointplot', 'roofline'], default='barplot')
     args = parser.parse_args()
     return args.plot_type
 
 
 def main():
     plot_type = parse_args()
+    if plot_type == 'roofline':
+        roofline()
+        return
     df, headers = pre_process(DATA_PATH)
     if plot_type == 'barplot':
         barplot(df, headers[0], headers[1])
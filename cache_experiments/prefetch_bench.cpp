@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <print>
+#include <random>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <libpmem.h>
+
+#include "Evict.h"
+#include "PmemEmu.h"
+#include "TscClock.h"
+
+// Read throughput against software prefetch distance, sequential and random line order, DRAM and the pmem pool
+// ./prefetch_bench [--distances=0,1,2,4] [--size-mb=256]
+// As root with the msr module loaded, Intel cpus are also measured with the hardware prefetchers off
+
+namespace {
+    using Clock = TscClock;
+    using Nanos = std::chrono::duration<double, std::nano>;
+
+    constexpr std::size_t CACHE_LINE_SIZE = 64;
+    constexpr std::size_t PAGE_SIZE = 4096;
+    constexpr std::size_t MB = 1024UL * 1024;
+    constexpr std::size_t DEFAULT_SIZE_MB = 256;    // Well past the L3, every pass after the flush reads from memory
+    constexpr std::size_t REPETITIONS = 5;          // Passes per point, the median is reported
+    constexpr std::array DEFAULT_DISTANCES{ 0UL, 1UL, 2UL, 4UL, 8UL, 16UL, 32UL, 64UL, 128UL };    // Lines ahead, 0 does not prefetch
+    constexpr std::string_view POOL_NAME = "PrefetchPool";                                          // Under PMEM_POOL_ROOT
+    constexpr std::size_t BENCH_CPU = 0;
+    // MSR_MISC_FEATURE_CONTROL, set bits disable the L2 streamer, L2 adjacent line, L1D next line and L1D IP stride prefetchers
+    constexpr off_t MISC_FEATURE_CONTROL = 0x1a4;
+    constexpr std::uint64_t PREFETCHERS_DISABLE = 0xf;
+
+    template<typename Func, typename... Args> constexpr void CallPosix(Func&& func, Args&&... args) {
+        const int err = std::forward<Func>(func)(std::forward<Args>(args)...);
+        if (err != 0) {
+            std::println(stdout, "CallPosix Error {}", std::strerror(err));
+            std::fflush(stdout);
+            std::abort();
+        }
+    }
+    auto PinThisThreadToCore(std::size_t core) -> void {
+        core %= std::jthread::hardware_concurrency();
+        cpu_set_t cpu_mask;
+        CPU_ZERO(&cpu_mask);
+        CPU_SET(core, &cpu_mask);
+        CallPosix(pthread_setaffinity_np, pthread_self(), sizeof(cpu_mask), &cpu_mask);
+    }
+    [[noreturn]] auto Fail(std::string_view what, std::string_view val) -> void {
+        std::println(stdout, "{} '{}'", what, val);
+        std::fflush(stdout);
+        std::exit(EXIT_FAILURE);
+    }
+    template<typename T> auto DoNotOptimize(const T& val) -> void { asm volatile("" : : "r,m"(val) : "memory"); }
+
+    // Hardware prefetchers of one cpu through /dev/cpu/<cpu>/msr, unavailable without root, the msr module or an Intel cpu
+    class PrefetcherControl {
+    public:
+        explicit PrefetcherControl(std::size_t cpu) {
+            if (!__builtin_cpu_is("intel")) return;
+            fd = open(("/dev/cpu/" + std::to_string(cpu) + "/msr").c_str(), O_RDWR);
+            if (fd < 0) return;
+            available = pread(fd, &original, sizeof(original), MISC_FEATURE_CONTROL) == sizeof(original);
+        }
+        PrefetcherControl(const PrefetcherControl&) = delete;
+        auto operator=(const PrefetcherControl&) -> PrefetcherControl& = delete;
+        ~PrefetcherControl() {
+            if (available && !Write(original)) std::println(stdout, "cannot restore MSR {:#x} to {:#x}: {}", MISC_FEATURE_CONTROL, original, std::strerror(errno));
+            if (fd >= 0) close(fd);
+        }
+        auto Available() const -> bool { return available; }
+        // On is the value found at startup, prefetchers firmware or an admin turned off stay off, false when the write fails
+        auto Enable(bool enabled) -> bool { return !available || Write(enabled ? original : original | PREFETCHERS_DISABLE); }
+
+    private:
+        auto Write(std::uint64_t val) -> bool { return pwrite(fd, &val, sizeof(val), MISC_FEATURE_CONTROL) == sizeof(val); }
+        int fd{ -1 };
+        bool available{};
+        std::uint64_t original{};
+    };
+
+    struct FreeAligned {
+        auto operator()(std::byte* ptr) const -> void { ::operator delete[](ptr, std::align_val_t{ PAGE_SIZE }); }
+    };
+    // The pool file mapped with libpmem, DAX on real pmem, page cache or tmpfs when emulating
+    class PoolMapping {
+    public:
+        explicit PoolMapping(std::size_t size) {
+            int isPmem{};
+            const std::string path = PmemEmu::PoolPath(POOL_NAME);
+            PmemEmu::CreatePoolDir(path);
+            data = static_cast<std::byte*>(pmem_map_file(path.c_str(), size, PMEM_FILE_CREATE, 0666, &length, &isPmem));
+            if (data == nullptr) Fail("cannot map pool", path);
+            std::println("Pool {} bytes, {}", length, isPmem != 0 ? "pmem" : "not pmem");
+        }
+        PoolMapping(const PoolMapping&) = delete;
+        auto operator=(const PoolMapping&) -> PoolMapping& = delete;
+        ~PoolMapping() { pmem_unmap(data, length); }
+        auto Span() const -> std::span<std::byte> { return { data, length }; }
+
+    private:
+        std::byte* data{};
+        std::size_t length{};
+    };
+
+    // One 8-byte load per line in order, prefetching the line distance positions ahead
+    auto Pass(std::span<const std::byte> range, std::span<const std::uint32_t> order, std::size_t distance) -> void {
+        std::uint64_t acc{};
+        for (auto i = 0UL; i < order.size(); ++i) {
+            if (distance != 0 && i + distance < order.size()) __builtin_prefetch(&range[order[i + distance] * CACHE_LINE_SIZE], 0, 3);
+            std::uint64_t word{};
+            std::memcpy(&word, &range[order[i] * CACHE_LINE_SIZE], sizeof(word));
+            acc += word;
+        }
+        DoNotOptimize(acc);
+    }
+    // Median nanoseconds per line, the range is flushed before every pass so no line starts in the cache
+    auto Measure(std::span<const std::byte> range, std::span<const std::uint32_t> order, std::size_t distance) -> double {
+        std::array<double, REPETITIONS> samples{};
+        for (auto& sample : samples) {
+            Evict::FlushRange(range);
+            const auto begin = Clock::now();
+            Pass(range, order, distance);
+            const auto end = Clock::now();
+            sample = Nanos{ end - begin }.count() / static_cast<double>(order.size());
+        }
+        std::ranges::sort(samples);
+        return samples[REPETITIONS / 2];
+    }
+
+    struct Options {
+        std::vector<std::size_t> distances{ DEFAULT_DISTANCES.begin(), DEFAULT_DISTANCES.end() };
+        std::size_t size{ DEFAULT_SIZE_MB * MB };
+    };
+    auto ParseNumber(std::string_view str) -> std::size_t {
+        std::size_t val{};
+        const auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), val);
+        if (ec != std::errc{} || ptr != str.data() + str.size()) Fail("expected a number", str);
+        return val;
+    }
+    auto ParseArgs(int argc, char* argv[]) -> Options {
+        Options options{};
+        for (const std::string_view arg : std::span{ argv, static_cast<std::size_t>(argc) }.subspan(1)) {
+            const auto eq = arg.find('=');
+            if (!arg.starts_with("--") || eq == std::string_view::npos) Fail("expected --key=values", arg);
+            const std::string_view key = arg.substr(2, eq - 2), val = arg.substr(eq + 1);
+            if (key == "distances") {
+                options.distances.clear();
+                for (const auto token : std::views::split(val, ',')) options.distances.push_back(ParseNumber(std::string_view{ token }));
+            } else if (key == "size-mb") options.size = ParseNumber(val) * MB;
+            else Fail("unknown option", key);
+        }
+        if (options.size == 0) Fail("size-mb must be positive", "0");
+        return options;
+    }
+}    // namespace
+
+auto main(int argc, char* argv[]) -> int {
+    PmemEmu::Init();
+    const Options options = ParseArgs(argc, argv);
+    PinThisThreadToCore(BENCH_CPU);
+
+    const std::unique_ptr<std::byte[], FreeAligned> dram{ new (std::align_val_t{ PAGE_SIZE }) std::byte[options.size] };
+    std::memset(dram.get(), 1, options.size);    // Fault every page in before timing
+    const PoolMapping pool{ options.size };
+    std::memset(pool.Span().data(), 1, options.size);
+    pmem_persist(pool.Span().data(), options.size);
+    const std::array<std::pair<std::string_view, std::span<const std::byte>>, 2> memories{ { { "Dram", { dram.get(), options.size } }, { "Pool", pool.Span().first(options.size) } } };
+
+    std::vector<std::uint32_t> sequential(options.size / CACHE_LINE_SIZE);
+    std::iota(sequential.begin(), sequential.end(), 0U);
+    std::vector<std::uint32_t> random{ sequential };
+    std::ranges::shuffle(random, std::mt19937_64{ std::random_device{}() });
+    const std::array<std::pair<std::string_view, std::span<const std::uint32_t>>, 2> patterns{ { { "Sequential", sequential }, { "Random", random } } };
+
+    PrefetcherControl prefetchers{ BENCH_CPU };
+    if (!prefetchers.Available()) std::println("MSR {:#x} of cpu {} not accessible, hardware prefetchers stay on", MISC_FEATURE_CONTROL, BENCH_CPU);
+    std::vector<bool> hardwareModes{ true };
+    if (prefetchers.Available()) hardwareModes.push_back(false);
+
+    for (const auto& [memory, range] : memories)
+        for (const auto& [pattern, order] : patterns)
+            for (const bool hardware : hardwareModes) {
+                // Returning unwinds through the destructor, which restores the MSR, Fail would exit past it
+                if (!prefetchers.Enable(hardware)) {
+                    std::println(stdout, "cannot write MSR {:#x}: {}", MISC_FEATURE_CONTROL, std::strerror(errno));
+                    return EXIT_FAILURE;
+                }
+                for (const auto distance : options.distances) {
+                    const double ns = Measure(range, order, distance);
+                    std::println("{} {} hardware prefetchers {} distance {}: {:.2f} ns/line, {:.2f} GB/s", memory, pattern, hardware ? "on" : "off", distance, ns,
+                                 static_cast<double>(CACHE_LINE_SIZE) / ns);
+                }
+            }
+    return 0;
+}
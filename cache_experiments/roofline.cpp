@@ -0,0 +1,286 @@
+#include <algorithm>
+#include <array>
+#include <barrier>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <optional>
+#include <print>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <pthread.h>
+
+#include <libpmem.h>
+
+#include "Evict.h"
+#include "PmemEmu.h"
+#include "TscClock.h"
+
+// Bandwidth and latency of DRAM against the pmem pool, the capacity-planning input for tiering
+// STREAM copy/scale/add/triad over 1, 2, 4, ... threads, and a pointer-chase latency curve from 4 KB to 4x L3 on one thread and on every cpu
+// ./roofline [--llc-kb=N], writes RooflineBandwidth.csv and RooflineLatency.csv for `python3 plot.py roofline`
+
+namespace {
+    using Clock = TscClock;
+    using Nanos = std::chrono::duration<double, std::nano>;
+
+    constexpr std::size_t CACHE_LINE_SIZE = 64;
+    constexpr std::size_t PAGE_SIZE = 4096;
+    constexpr std::size_t STREAM_REPETITIONS = 5;    // Passes per kernel, the best is reported as STREAM does
+    constexpr std::size_t CHASE_MIN_SIZE = 4096;
+    constexpr std::size_t CHASE_LOADS = 1 << 22;    // Dependent loads per latency point and thread
+    constexpr double SCALAR = 3.0;
+    constexpr std::string_view POOL_NAME = "RooflinePool";    // Under PMEM_POOL_ROOT
+    constexpr std::string_view BANDWIDTH_CSV = "RooflineBandwidth.csv";
+    constexpr std::string_view LATENCY_CSV = "RooflineLatency.csv";
+    constexpr std::string_view LLC_ARG = "--llc-kb=";
+
+    template<typename Func, typename... Args> constexpr void CallPosix(Func&& func, Args&&... args) {
+        const int err = std::forward<Func>(func)(std::forward<Args>(args)...);
+        if (err != 0) {
+            std::println(stdout, "CallPosix Error {}", std::strerror(err));
+            std::fflush(stdout);
+            std::abort();
+        }
+    }
+    auto PinThisThreadToCore(std::size_t core) -> void {
+        core %= std::jthread::hardware_concurrency();
+        cpu_set_t cpu_mask;
+        CPU_ZERO(&cpu_mask);
+        CPU_SET(core, &cpu_mask);
+        CallPosix(pthread_setaffinity_np, pthread_self(), sizeof(cpu_mask), &cpu_mask);
+    }
+    template<typename T> auto DoNotOptimize(const T& val) -> void { asm volatile("" : : "r,m"(val) : "memory"); }
+
+    // Powers of two up to the logical cpus, then the logical cpus themselves
+    auto ThreadCounts() -> std::vector<std::size_t> {
+        const std::size_t cpus = std::max(1U, std::jthread::hardware_concurrency());
+        std::vector<std::size_t> counts{};
+        for (std::size_t n = 1; n < cpus; n *= 2) counts.push_back(n);
+        counts.push_back(cpus);
+        return counts;
+    }
+    // Powers of two from CHASE_MIN_SIZE, then maxSize itself
+    auto ChaseSizes(std::size_t maxSize) -> std::vector<std::size_t> {
+        std::vector<std::size_t> sizes{};
+        for (std::size_t bytes = CHASE_MIN_SIZE; bytes < maxSize; bytes *= 2) sizes.push_back(bytes);
+        sizes.push_back(maxSize);
+        return sizes;
+    }
+    // Largest data cache of cpu0 from sysfs, only read without --llc-kb
+    auto LastLevelCacheSize() -> std::size_t {
+        std::size_t size{};
+        try {
+            for (const auto& level : Evict::ReadCacheLevels(0)) size = std::max(size, level.size);
+        } catch (const std::exception& e) {
+            std::println(stdout, "cannot read cache levels from sysfs: {}", e.what());
+        }
+        if (size == 0) {
+            std::println(stdout, "no cache levels in sysfs, pass --llc-kb=N");
+            std::fflush(stdout);
+            std::abort();
+        }
+        return size;
+    }
+
+    struct FreeAligned {
+        auto operator()(std::byte* ptr) const -> void { ::operator delete[](ptr, std::align_val_t{ PAGE_SIZE }); }
+    };
+    // The pool file mapped with libpmem, DAX on real pmem, page cache or tmpfs when emulating
+    class PoolMapping {
+    public:
+        explicit PoolMapping(std::size_t size) {
+            int isPmem{};
+            const std::string path = PmemEmu::PoolPath(POOL_NAME);
+            PmemEmu::CreatePoolDir(path);
+            data = static_cast<std::byte*>(pmem_map_file(path.c_str(), size, PMEM_FILE_CREATE, 0666, &length, &isPmem));
+            if (data == nullptr) {
+                std::println(stdout, "cannot map pool {}", path);
+                std::fflush(stdout);
+                std::abort();
+            }
+            std::println("Pool {} bytes, {}", length, isPmem != 0 ? "pmem" : "not pmem");
+        }
+        PoolMapping(const PoolMapping&) = delete;
+        auto operator=(const PoolMapping&) -> PoolMapping& = delete;
+        ~PoolMapping() { pmem_unmap(data, length); }
+        auto Span() const -> std::span<std::byte> { return { data, length }; }
+
+    private:
+        std::byte* data{};
+        std::size_t length{};
+    };
+
+    // STREAM kernels, bytes counts the arrays read and written, write allocate traffic is not counted
+    enum class Kernel { Copy, Scale, Add, Triad };
+    struct KernelInfo {
+        std::string_view name;
+        Kernel kernel;
+        std::size_t arrays;
+    };
+    constexpr std::array<KernelInfo, 4> KERNELS{ { { "Copy", Kernel::Copy, 2 }, { "Scale", Kernel::Scale, 2 }, { "Add", Kernel::Add, 3 }, { "Triad", Kernel::Triad, 3 } } };
+
+    struct StreamArrays {
+        std::span<double> a;
+        std::span<double> b;
+        std::span<double> c;
+    };
+    // Three arrays of elements doubles back to back in memory
+    auto CarveArrays(std::span<std::byte> memory, std::size_t elements) -> StreamArrays {
+        const auto array = [memory, elements](std::size_t i) { return std::span{ static_cast<double*>(static_cast<void*>(&memory[i * elements * sizeof(double)])), elements }; };
+        return { array(0), array(1), array(2) };
+    }
+    auto RunKernel(Kernel kernel, const StreamArrays& arr, std::size_t begin, std::size_t end) -> void {
+        switch (kernel) {
+            case Kernel::Copy:
+                for (auto j = begin; j < end; ++j) arr.c[j] = arr.a[j];
+                break;
+            case Kernel::Scale:
+                for (auto j = begin; j < end; ++j) arr.b[j] = SCALAR * arr.c[j];
+                break;
+            case Kernel::Add:
+                for (auto j = begin; j < end; ++j) arr.c[j] = arr.a[j] + arr.b[j];
+                break;
+            case Kernel::Triad:
+                for (auto j = begin; j < end; ++j) arr.a[j] = arr.b[j] + SCALAR * arr.c[j];
+                break;
+        }
+    }
+    // Best GB/s of every kernel with threads splitting the arrays, timed from the start barrier to the end barrier
+    auto MeasureBandwidth(const StreamArrays& arr, std::size_t threads) -> std::array<double, KERNELS.size()> {
+        std::array<double, KERNELS.size()> best{};
+        const std::size_t elements = arr.a.size();
+        std::barrier startBarrier{ static_cast<std::ptrdiff_t>(threads) };
+        std::barrier endBarrier{ static_cast<std::ptrdiff_t>(threads) };
+        std::vector<std::jthread> team{};
+        for (auto tid = 0UL; tid < threads; ++tid) {
+            team.emplace_back([tid, threads, elements, &arr, &best, &startBarrier, &endBarrier]() {
+                PinThisThreadToCore(tid);
+                const std::size_t begin = elements * tid / threads;
+                const std::size_t end = elements * (tid + 1) / threads;
+                std::ranges::fill(arr.a.subspan(begin, end - begin), 1.0);
+                std::ranges::fill(arr.b.subspan(begin, end - begin), 2.0);
+                std::ranges::fill(arr.c.subspan(begin, end - begin), 0.0);
+                for (auto rep = 0UL; rep < STREAM_REPETITIONS; ++rep) {
+                    for (auto k = 0UL; k < KERNELS.size(); ++k) {
+                        startBarrier.arrive_and_wait();
+                        const auto beginTime = Clock::now();
+                        RunKernel(KERNELS[k].kernel, arr, begin, end);
+                        endBarrier.arrive_and_wait();
+                        if (tid != 0) continue;
+                        const double bytes = static_cast<double>(KERNELS[k].arrays * elements * sizeof(double));
+                        best[k] = std::max(best[k], bytes / Nanos{ Clock::now() - beginTime }.count());
+                    }
+                }
+            });
+        }
+        team.clear();
+        return best;
+    }
+
+    // Links the lines of range into a single random cycle, each line holds the byte offset of the next, returns the visiting order
+    auto BuildChain(std::span<std::byte> range) -> std::vector<std::uint32_t> {
+        std::vector<std::uint32_t> order(range.size() / CACHE_LINE_SIZE);
+        std::iota(order.begin(), order.end(), 0U);
+        std::ranges::shuffle(order, std::mt19937_64{ std::random_device{}() });
+        for (auto i = 0UL; i < order.size(); ++i) {
+            const std::uint64_t next = std::uint64_t{ order[(i + 1) % order.size()] } * CACHE_LINE_SIZE;
+            std::memcpy(&range[std::size_t{ order[i] } * CACHE_LINE_SIZE], &next, sizeof(next));
+        }
+        return order;
+    }
+    auto Chase(std::span<const std::byte> range, std::uint64_t offset, std::size_t loads) -> std::uint64_t {
+        for (auto i = 0UL; i < loads; ++i) std::memcpy(&offset, &range[offset], sizeof(offset));
+        return offset;
+    }
+    // Mean ns per dependent load, every thread chases the same cycle from its own point on it
+    auto MeasureLatency(std::span<const std::byte> range, std::span<const std::uint32_t> order, std::size_t threads) -> double {
+        std::vector<double> latencies(threads);
+        std::barrier startBarrier{ static_cast<std::ptrdiff_t>(threads) };
+        {
+            std::vector<std::jthread> team{};
+            for (auto tid = 0UL; tid < threads; ++tid) {
+                team.emplace_back([tid, threads, range, order, &latencies, &startBarrier]() {
+                    PinThisThreadToCore(tid);
+                    std::uint64_t offset = std::uint64_t{ order[order.size() * tid / threads] } * CACHE_LINE_SIZE;
+                    offset = Chase(range, offset, std::min(order.size(), CHASE_LOADS));    // Warm up, one lap brings in what fits the caches
+                    startBarrier.arrive_and_wait();
+                    const auto begin = Clock::now();
+                    offset = Chase(range, offset, CHASE_LOADS);
+                    latencies[tid] = Nanos{ Clock::now() - begin }.count() / static_cast<double>(CHASE_LOADS);
+                    DoNotOptimize(offset);
+                });
+            }
+        }
+        return std::accumulate(latencies.begin(), latencies.end(), 0.0) / static_cast<double>(threads);
+    }
+}    // namespace
+
+auto main(int argc, char* argv[]) -> int {
+    PmemEmu::Init();
+    // --llc-kb overrides sysfs, which virtual machines often misreport or leave empty, so sysfs is only read without it
+    std::optional<std::size_t> llcArg{};
+    for (const std::string_view arg : std::span{ argv, static_cast<std::size_t>(argc) }.subspan(1)) {
+        std::size_t kb{};
+        const std::string_view val = arg.substr(std::min(arg.size(), LLC_ARG.size()));
+        const auto [ptr, ec] = std::from_chars(val.data(), val.data() + val.size(), kb);
+        if (!arg.starts_with(LLC_ARG) || ec != std::errc{} || ptr != val.data() + val.size() || kb == 0) {
+            std::println(stdout, "usage: roofline [--llc-kb=N]");
+            return EXIT_FAILURE;
+        }
+        llcArg = kb * 1024;
+    }
+    const std::size_t llc = llcArg ? *llcArg : LastLevelCacheSize();
+    const std::size_t maxChase = 4 * llc;
+    // STREAM wants every array at least 4x the caches, the chase reuses the same memory
+    const std::size_t elements = maxChase / sizeof(double);
+    const std::size_t size = std::max(3 * elements * sizeof(double), maxChase);
+    std::println("Last level cache {} bytes, STREAM arrays {} bytes, chase up to {} bytes", llc, elements * sizeof(double), maxChase);
+
+    const std::unique_ptr<std::byte[], FreeAligned> dram{ new (std::align_val_t{ PAGE_SIZE }) std::byte[size] };
+    std::memset(dram.get(), 0, size);    // Fault every page in before timing
+    const PoolMapping pool{ size };
+    std::memset(pool.Span().data(), 0, size);
+    pmem_persist(pool.Span().data(), size);
+    const std::array<std::pair<std::string_view, std::span<std::byte>>, 2> memories{ { { "Dram", { dram.get(), size } }, { "Pool", pool.Span().first(size) } } };
+
+    std::ofstream bandwidthCsv{ std::string{ BANDWIDTH_CSV } };
+    bandwidthCsv << "memory,kernel,threads,GB/s\n";
+    std::ofstream latencyCsv{ std::string{ LATENCY_CSV } };
+    latencyCsv << "memory,threads,bytes,ns\n";
+    const std::size_t cpus = std::max(1U, std::jthread::hardware_concurrency());
+    const std::vector<std::size_t> chaseThreads = cpus == 1 ? std::vector<std::size_t>{ 1 } : std::vector<std::size_t>{ 1, cpus };
+    for (const auto& [memory, range] : memories) {
+        const StreamArrays arr = CarveArrays(range, elements);
+        for (const auto threads : ThreadCounts()) {
+            const auto best = MeasureBandwidth(arr, threads);
+            for (auto k = 0UL; k < KERNELS.size(); ++k) {
+                std::println("{} {} threads {}: {:.2f} GB/s", memory, KERNELS[k].name, threads, best[k]);
+                bandwidthCsv << memory << "," << KERNELS[k].name << "," << threads << "," << best[k] << "\n";
+            }
+        }
+        for (const auto bytes : ChaseSizes(maxChase)) {
+            const auto chaseRange = range.first(bytes);
+            const auto order = BuildChain(chaseRange);
+            for (const auto threads : chaseThreads) {
+                const double ns = MeasureLatency(chaseRange, order, threads);
+                std::println("{} chase {} bytes threads {}: {:.2f} ns", memory, bytes, threads, ns);
+                latencyCsv << memory << "," << threads << "," << bytes << "," << ns << "\n";
+            }
+        }
+    }
+    return 0;
+}
@@ -1,3 +1,4 @@
+import os
 import subprocess
 import glob
 from colorama import Fore, Style
@@ -36,7 +37,7 @@ def build_bins() -> list[str]:
 def run_bins(executables: list[str]):
     print(f'{Fore.YELLOW}Executing binaries{Style.RESET_ALL}')
     for executable in executables:
-        subprocess.run(['rm', '-f', *glob.glob('/mnt/pmem0/myrontsa/*')], check=True)
+        subprocess.run(['rm', '-f', *glob.glob(os.environ.get('PMEM_POOL_ROOT', '/mnt/pmem0/myrontsa') + '/*')], check=True)
         print(f'{Fore.YELLOW}Executing{executable}{Style.RESET_ALL}')
         subprocess.run(
             ['stdbuf', '-o0', '-e0'] +
@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <print>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <pthread.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <libpmemobj++/pool.hpp>
+
+#include "PmemEmu.h"
+
+// Cost of the ways cache_warm hands a benchmark to a new execution context, each broken into phases
+// ./spawn_cost
+
+namespace {
+    using Clock = std::chrono::steady_clock;    // CLOCK_MONOTONIC, comparable across processes
+    using Nanos = std::chrono::nanoseconds;
+
+    constexpr std::size_t REPETITIONS = 100;
+    constexpr std::size_t FORK_REPETITIONS = 20;    // Touching the larger COW sizes takes a good fraction of a second
+    constexpr std::size_t MB = 1024UL * 1024;
+    constexpr std::size_t PAGE_SIZE = 4096;
+    constexpr std::array COW_SIZES_MB{ 0UL, 64UL, 512UL };    // Resident parent memory the child inherits
+    constexpr std::string_view POOL_NAME = "SpawnCostPool";     // Under PMEM_POOL_ROOT
+    constexpr std::size_t POOL_SIZE = 64 * MB;
+    constexpr std::string_view CHILD_ARG = "--child";
+    constexpr int REPORT_FD = 3;    // Exec'd children write their start time here
+    constexpr std::size_t MAIN_CPU = 0;
+    constexpr std::size_t WORKER_CPU = 1;
+
+    template<typename Func, typename... Args> constexpr void CallPosix(Func&& func, Args&&... args) {
+        const int err = std::forward<Func>(func)(std::forward<Args>(args)...);
+        if (err != 0) {
+            std::println(stdout, "CallPosix Error {}", std::strerror(err));
+            std::fflush(stdout);
+            std::abort();
+        }
+    }
+    auto PinThisThreadToCore(std::size_t core) -> void {
+        core %= std::jthread::hardware_concurrency();
+        cpu_set_t cpu_mask;
+        CPU_ZERO(&cpu_mask);
+        CPU_SET(core, &cpu_mask);
+        CallPosix(pthread_setaffinity_np, pthread_self(), sizeof(cpu_mask), &cpu_mask);
+    }
+    auto Check(bool ok, std::string_view what) -> void {
+        if (ok) return;
+        std::println(stdout, "{} failed: {}", what, std::strerror(errno));
+        std::fflush(stdout);
+        std::abort();
+    }
+
+    // Samples per phase in insertion order, printed as min / median / max
+    class Phases {
+    public:
+        explicit Phases(std::string _name)
+            : name{ std::move(_name) } {}
+        auto Add(std::string_view phase, Clock::duration duration) -> void {
+            auto it = std::ranges::find(samples, phase, &Samples::first);
+            if (it == samples.end()) it = samples.insert(samples.end(), { std::string{ phase }, {} });
+            it->second.push_back(std::chrono::duration_cast<Nanos>(duration));
+        }
+        auto Print() -> void {
+            for (auto& [phase, durations] : samples) {
+                std::ranges::sort(durations);
+                std::println("{}_{}: min {} ns, median {} ns, max {} ns", name, phase, durations.front().count(), durations[durations.size() / 2].count(),
+                             durations.back().count());
+            }
+        }
+
+    private:
+        using Samples = std::pair<std::string, std::vector<Nanos>>;
+        std::string name{};
+        std::vector<Samples> samples{};
+    };
+
+    // Written by forked children, read by the parent after waitpid
+    struct ChildTimes {
+        Clock::time_point start{};
+        Clock::time_point touched{};
+    };
+
+    auto ThreadCreateJoin() -> void {
+        Phases phases{ "Thread" };
+        for (auto rep = 0UL; rep < REPETITIONS; ++rep) {
+            Clock::time_point started{}, finished{};
+            const auto begin = Clock::now();
+            std::thread thread{ [&started, &finished]() {
+                started = Clock::now();
+                finished = Clock::now();
+            } };
+            const auto created = Clock::now();
+            thread.join();
+            const auto joined = Clock::now();
+            phases.Add("Create", created - begin);    // pthread_create returns
+            phases.Add("Start", started - begin);     // First instruction of the new thread
+            phases.Add("Join", joined - finished);    // Thread exit until join returns
+        }
+        phases.Print();
+    }
+
+    // A long lived pinned worker takes one task per repetition, it spins or blocks on the futex behind std::atomic::wait
+    auto PoolHandoff(bool spin) -> void {
+        Phases phases{ spin ? "PoolHandoffSpin" : "PoolHandoffFutex" };
+        std::atomic<std::uint64_t> posted{}, done{};
+        Clock::time_point postedAt{}, startedAt{}, doneAt{};
+        std::jthread worker{ [&](std::stop_token stop) {
+            PinThisThreadToCore(WORKER_CPU);
+            for (std::uint64_t seen = 0;;) {
+                if (spin)
+                    while (posted.load(std::memory_order_acquire) == seen) {}
+                else
+                    posted.wait(seen, std::memory_order_acquire);
+                seen = posted.load(std::memory_order_acquire);
+                if (stop.stop_requested()) return;
+                startedAt = Clock::now();
+                doneAt = Clock::now();
+                done.store(seen, std::memory_order_release);
+                if (!spin) done.notify_one();
+            }
+        } };
+        for (auto rep = 1UL; rep <= REPETITIONS; ++rep) {
+            postedAt = Clock::now();
+            posted.store(rep, std::memory_order_release);
+            if (!spin) posted.notify_one();
+            if (spin)
+                while (done.load(std::memory_order_acquire) != rep) {}
+            else
+                for (auto val = done.load(std::memory_order_acquire); val != rep; val = done.load(std::memory_order_acquire)) done.wait(val, std::memory_order_acquire);
+            const auto observed = Clock::now();
+            phases.Add("Wake", startedAt - postedAt);    // Post until the worker runs the task
+            phases.Add("Return", observed - doneAt);     // Task done until the poster sees it
+        }
+        worker.request_stop();
+        posted.store(REPETITIONS + 1, std::memory_order_release);
+        posted.notify_one();
+        worker.join();
+        phases.Print();
+    }
+
+    // The parent keeps cowSize bytes resident, the child optionally writes one byte per page, each write a COW fault
+    auto ForkWait(std::size_t cowSize, bool touch) -> void {
+        Phases phases{ "Fork" + std::to_string(cowSize / MB) + "MB" + (touch ? "Touch" : "") };
+        std::vector<std::byte> buffer(cowSize, std::byte{ 1 });
+        void* shared = mmap(nullptr, sizeof(ChildTimes), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        Check(shared != MAP_FAILED, "mmap");
+        auto* times = new (shared) ChildTimes{};
+        for (auto rep = 0UL; rep < FORK_REPETITIONS; ++rep) {
+            const auto begin = Clock::now();
+            const pid_t pid = fork();
+            Check(pid >= 0, "fork");
+            if (pid == 0) {
+                times->start = Clock::now();
+                if (touch)
+                    for (auto i = 0UL; i < buffer.size(); i += PAGE_SIZE) buffer[i] = std::byte{ 2 };
+                times->touched = Clock::now();
+                _exit(EXIT_SUCCESS);
+            }
+            const auto forked = Clock::now();
+            Check(waitpid(pid, nullptr, 0) == pid, "waitpid");
+            const auto reaped = Clock::now();
+            phases.Add("Fork", forked - begin);        // Parent returns from fork, page tables copied
+            phases.Add("Start", times->start - begin);
+            if (touch) phases.Add("Touch", times->touched - times->start);
+            phases.Add("Reap", reaped - times->touched);    // Child exit, address space teardown, waitpid
+        }
+        munmap(shared, sizeof(ChildTimes));
+        phases.Print();
+    }
+
+    enum class SpawnType { ForkExec, VforkExec, PosixSpawn };
+    // Own function so the vfork child, sharing the parent stack until exec, never touches the caller's frame
+    auto SpawnChild(SpawnType type, const char* path, char* const argv[], int reportFd) -> pid_t {
+        pid_t pid{};
+        if (type == SpawnType::PosixSpawn) {
+            posix_spawn_file_actions_t actions{};
+            posix_spawn_file_actions_init(&actions);
+            posix_spawn_file_actions_adddup2(&actions, reportFd, REPORT_FD);
+            CallPosix(posix_spawn, &pid, path, &actions, nullptr, argv, environ);
+            posix_spawn_file_actions_destroy(&actions);
+            return pid;
+        }
+        pid = type == SpawnType::VforkExec ? vfork() : fork();
+        Check(pid >= 0, "fork");
+        if (pid == 0) {
+            dup2(reportFd, REPORT_FD);
+            execv(path, argv);
+            _exit(127);
+        }
+        return pid;
+    }
+    // Children re-exec this binary with CHILD_ARG, which reports its start time through a pipe on REPORT_FD
+    auto SpawnWait(SpawnType type) -> void {
+        constexpr std::array<std::string_view, 3> NAMES{ "ForkExec", "VforkExec", "PosixSpawn" };
+        Phases phases{ std::string{ NAMES[static_cast<std::size_t>(type)] } };
+        const std::string self = std::filesystem::read_symlink("/proc/self/exe").string();
+        std::string childArg{ CHILD_ARG };
+        char* const argv[] = { const_cast<char*>(self.c_str()), childArg.data(), nullptr };
+        for (auto rep = 0UL; rep < REPETITIONS; ++rep) {
+            int fds[2];
+            Check(pipe(fds) == 0, "pipe");
+            const auto begin = Clock::now();
+            const pid_t pid = SpawnChild(type, self.c_str(), argv, fds[1]);
+            const auto spawned = Clock::now();
+            close(fds[1]);
+            Nanos::rep started{};
+            Check(read(fds[0], &started, sizeof(started)) == sizeof(started), "read child start");
+            close(fds[0]);
+            Check(waitpid(pid, nullptr, 0) == pid, "waitpid");
+            const auto reaped = Clock::now();
+            const Clock::time_point startedAt{ Nanos{ started } };
+            phases.Add("Spawn", spawned - begin);      // Parent resumes, after exec for vfork
+            phases.Add("Start", startedAt - begin);    // exec, dynamic loading and static init until main
+            phases.Add("Reap", reaped - startedAt);
+        }
+        phases.Print();
+    }
+
+    // std::system goes through /bin/sh, as SystemCallWrapper does
+    auto SystemWait() -> void {
+        Phases phases{ "System" };
+        for (auto rep = 0UL; rep < REPETITIONS; ++rep) {
+            const auto begin = Clock::now();
+            Check(std::system("true") == 0, "system");
+            phases.Add("Total", Clock::now() - begin);
+        }
+        phases.Print();
+    }
+
+    // SystemCallWrapper closes the pool before the child runs and reopens it afterwards
+    auto PoolReopen() -> void {
+        Phases phases{ "PoolReopen" };
+        const std::string layout{ POOL_NAME };
+        const std::string path = PmemEmu::PoolPath(POOL_NAME);
+        PmemEmu::CreatePoolDir(path);
+        if (!std::filesystem::exists(path)) pmem::obj::pool_base::create(path, layout, POOL_SIZE).close();
+        auto pool = pmem::obj::pool_base::open(path, layout);
+        for (auto rep = 0UL; rep < REPETITIONS; ++rep) {
+            const auto begin = Clock::now();
+            pool.close();
+            const auto closed = Clock::now();
+            const int consistent = pmem::obj::pool_base::check(path, layout);
+            const auto checked = Clock::now();
+            Check(consistent == 1, "pool check");
+            pool = pmem::obj::pool_base::open(path, layout);
+            const auto opened = Clock::now();
+            phases.Add("Close", closed - begin);
+            phases.Add("Check", checked - closed);
+            phases.Add("Open", opened - checked);
+        }
+        pool.close();
+        phases.Print();
+    }
+}    // namespace
+
+auto main(int argc, char* argv[]) -> int {
+    PmemEmu::Init();
+    if (argc > 1 && argv[1] == CHILD_ARG) {
+        const Nanos::rep started = std::chrono::duration_cast<Nanos>(Clock::now().time_since_epoch()).count();
+        return write(REPORT_FD, &started, sizeof(started)) == sizeof(started) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    PinThisThreadToCore(MAIN_CPU);
+    ThreadCreateJoin();
+    PoolHandoff(true);
+    PoolHandoff(false);
+    for (const auto cowSizeMB : COW_SIZES_MB) {
+        ForkWait(cowSizeMB * MB, false);
+        if (cowSizeMB != 0) ForkWait(cowSizeMB * MB, true);
+    }
+    SpawnWait(SpawnType::ForkExec);
+    SpawnWait(SpawnType::VforkExec);
+    SpawnWait(SpawnType::PosixSpawn);
+    SystemWait();
+    PoolReopen();
+    return 0;
+}
@@ -22,6 +22,7 @@
 #include <libpmemobj++/transaction.hpp>
 
 #include "Instrumenter.h"
+#include "PmemEmu.h"
 
 /* ---Config--- */
 constexpr uint64_t POOL_SIZE = PMEMOBJ_MIN_POOL * 64;
@@ -37,9 +38,8 @@ constexpr uint64_t PERSISTENT_ARR_LEN = 2 * CACHE_SIZE;
 /* --- */
 
 /* ---Persistent--- */
-#define MOUNT_DIR "/mnt/pmem0/myrontsa/"
 #define POOL_PATH_REL "pool_dir/pool"
-constexpr auto PoolPath = MOUNT_DIR POOL_PATH_REL;
+const std::string PoolPath = PmemEmu::PoolPath(POOL_PATH_REL);
 constexpr const char* PoolLayout = "pool";
 struct Root {
     pmem::obj::persistent_ptr<uint64_t[PERSISTENT_ARR_LEN]> array;
@@ -84,19 +84,21 @@ namespace {
         TIME_SCOPE("System_Call_Write");
         for (auto i = 0ul; i < size; ++i)
             RootPtr->array[i] = i;
-        RootPtr->array.persist();
+        PmemEmu::Persist(Pool, RootPtr->array.get(), size * sizeof(uint64_t));    // array.persist() only persists the pointer
     }
 }    // namespace
 
 auto main() -> int {
+    PmemEmu::Init();
     try {
         int isConsistent = pmem::obj::pool<Root>::check(PoolPath, PoolLayout);
         // std::cout << isConsistent << " errno: " << strerror(errno) << '\n';
         if (isConsistent > 0)
             Pool = pmem::obj::pool<Root>::open(PoolPath, PoolLayout);
-        else if (isConsistent < 0)
+        else if (isConsistent < 0) {
+            PmemEmu::CreatePoolDir(PoolPath);
             Pool = pmem::obj::pool<Root>::create(PoolPath, PoolLayout, POOL_SIZE);
-        else {
+        } else {
             std::cout << "IsConsistent: " << isConsistent << std::endl;
             assert(false);
         }
@@ -1,36 +1,159 @@
-#include <cassert>
+#include <algorithm>
+#include <barrier>
 #include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <x86intrin.h>
+
+#include "TscClock.h"
+
+// Cost of every clock source the tracing hot path could use: per-call latency, resolution and multi-thread scalability
+// Then the checks TscClock relies on: invariant TSC, rate drift and the TSC offset of every cpu against cpu 0
+// Build with DEBUG := 0, the reads fold into sinks so -O3 cannot drop them
 
 namespace {
-    constexpr uint64_t Workload = 100'000'000;
+    constexpr std::uint64_t Workload = 10'000'000;            // Reads per latency measurement and per thread when scaling
+    constexpr std::uint64_t ResolutionSamples = 1'000'000;    // Consecutive read pairs searched for the smallest step
     using SteadyClock = std::chrono::steady_clock;
-    using Millis = std::chrono::milliseconds;
+    using Nanos = std::chrono::duration<double, std::nano>;
+
+    // Keeps val alive without a memory round trip per read
+    template<typename T> auto DoNotOptimize(const T& val) -> void { asm volatile("" : : "r,m"(val) : "memory"); }
+
+    auto PinThisThreadToCore(std::size_t core) -> void {
+        cpu_set_t cpu_mask;
+        CPU_ZERO(&cpu_mask);
+        CPU_SET(core % std::thread::hardware_concurrency(), &cpu_mask);
+        const int err = pthread_setaffinity_np(pthread_self(), sizeof(cpu_mask), &cpu_mask);
+        if (err != 0) throw std::runtime_error{ "pthread_setaffinity_np" };
+    }
+
+    // Sources return raw ticks, nanoseconds except for the TSC reads
+    template<typename Clock> struct ChronoSource {
+        static auto Read() -> std::uint64_t { return static_cast<std::uint64_t>(Clock::now().time_since_epoch().count()); }
+        static constexpr bool Tsc = false;
+    };
+    template<clockid_t ClockId> struct PosixSource {
+        static auto Read() -> std::uint64_t {
+            struct timespec tm {};
+            clock_gettime(ClockId, &tm);
+            return static_cast<std::uint64_t>(tm.tv_sec) * 1'000'000'000 + static_cast<std::uint64_t>(tm.tv_nsec);
+        }
+        static constexpr bool Tsc = false;
+    };
+    struct RdtscSource {
+        static auto Read() -> std::uint64_t { return __rdtsc(); }
+        static constexpr bool Tsc = true;
+    };
+    // Waits for earlier instructions to complete before reading
+    struct RdtscpSource {
+        static auto Read() -> std::uint64_t {
+            unsigned int aux{};
+            return __rdtscp(&aux);
+        }
+        static constexpr bool Tsc = true;
+    };
+    // Also keeps later instructions from starting early, the usual fence for timing short regions
+    struct LfenceRdtscSource {
+        static auto Read() -> std::uint64_t {
+            _mm_lfence();
+            return __rdtsc();
+        }
+        static constexpr bool Tsc = true;
+    };
 
-    auto SteadyClockNow() -> void { SteadyClock::now(); }
-    auto GetTimeMillisNow() -> void {
-        struct timespec tm;
-        const auto r = clock_gettime(CLOCK_MONOTONIC, &tm);
-        assert(r != -1);
+    template<typename Source> auto TicksToNs(std::uint64_t ticks) -> double {
+        if constexpr (Source::Tsc) return static_cast<double>(ticks) / Tsc::TicksPerNs();
+        else return static_cast<double>(ticks);
     }
 
-    using NowFunc = void (*)();
-    NowFunc Now = SteadyClockNow;
-    auto BenchmarkClock() -> void {
+    // Nanoseconds per read, back to back
+    template<typename Source> auto Latency(std::uint64_t reads) -> double {
+        std::uint64_t sink{};
         const auto begin = SteadyClock::now();
-        for (auto i = 0u; i < Workload; ++i) {
-            Now();
-            // ;
+        for (auto i = 0UL; i < reads; ++i) {
+            const std::uint64_t val = Source::Read();
+            DoNotOptimize(val);
+            sink ^= val;
         }
         const auto end = SteadyClock::now();
-        const auto dur = std::chrono::duration_cast<Millis>(end - begin);
-        std::cout << dur.count() << " ms\n";
+        DoNotOptimize(sink);
+        return Nanos{ end - begin }.count() / static_cast<double>(reads);
+    }
+    // Smallest nonzero step between consecutive reads, the clock cannot tell apart anything shorter
+    template<typename Source> auto Resolution() -> double {
+        std::uint64_t smallest = std::numeric_limits<std::uint64_t>::max();
+        std::uint64_t prev = Source::Read();
+        for (auto i = 0UL; i < ResolutionSamples; ++i) {
+            const std::uint64_t cur = Source::Read();
+            if (cur != prev) smallest = std::min(smallest, cur - prev);
+            prev = cur;
+        }
+        return TicksToNs<Source>(smallest);
+    }
+    // Mean per-thread latency with threads reading concurrently, flat when the source scales
+    template<typename Source> auto ScaledLatency(std::size_t nThreads) -> double {
+        std::vector<double> latencies(nThreads);
+        std::barrier startBarrier{ static_cast<std::ptrdiff_t>(nThreads) };
+        {
+            std::vector<std::jthread> threads{};
+            for (auto tid = 0UL; tid < nThreads; ++tid) {
+                threads.emplace_back([tid, &latencies, &startBarrier]() {
+                    PinThisThreadToCore(tid);
+                    startBarrier.arrive_and_wait();
+                    latencies.at(tid) = Latency<Source>(Workload);
+                });
+            }
+        }
+        double sum{};
+        for (const auto latency : latencies) sum += latency;
+        return sum / static_cast<double>(nThreads);
+    }
+
+    auto ThreadCounts() -> std::vector<std::size_t> {
+        const std::size_t cpus = std::max(1U, std::thread::hardware_concurrency());
+        std::vector<std::size_t> counts{};
+        for (std::size_t n = 1; n < cpus; n *= 2) counts.push_back(n);
+        counts.push_back(cpus);
+        return counts;
+    }
+
+    template<typename Source> auto BenchmarkClock(std::string_view name) -> void {
+        Latency<Source>(Workload / 10);    // Warm up, first vDSO calls fault in the data page
+        std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(2) << " latency " << std::setw(8) << Latency<Source>(Workload)
+                  << " ns, resolution " << std::setw(10) << Resolution<Source>() << " ns, threads";
+        for (const auto nThreads : ThreadCounts()) std::cout << " " << nThreads << ": " << ScaledLatency<Source>(nThreads) << " ns";
+        std::cout << "\n";
     }
 }    // namespace
 
 auto main() -> int {
-    Now = SteadyClockNow;
-    BenchmarkClock();
-    Now = GetTimeMillisNow;
-    BenchmarkClock();
+    PinThisThreadToCore(0);
+    std::cout << "TSC ticks per ns: " << Tsc::TicksPerNs() << ", scaling is ns per read per thread\n";
+    BenchmarkClock<ChronoSource<std::chrono::steady_clock>>("steady_clock");
+    BenchmarkClock<ChronoSource<std::chrono::system_clock>>("system_clock");
+    BenchmarkClock<ChronoSource<std::chrono::high_resolution_clock>>("high_resolution_clock");
+    BenchmarkClock<PosixSource<CLOCK_MONOTONIC>>("CLOCK_MONOTONIC");
+    BenchmarkClock<PosixSource<CLOCK_MONOTONIC_COARSE>>("CLOCK_MONOTONIC_COARSE");
+    BenchmarkClock<PosixSource<CLOCK_MONOTONIC_RAW>>("CLOCK_MONOTONIC_RAW");
+    BenchmarkClock<PosixSource<CLOCK_THREAD_CPUTIME_ID>>("CLOCK_THREAD_CPUTIME_ID");
+    BenchmarkClock<RdtscSource>("rdtsc");
+    BenchmarkClock<RdtscpSource>("rdtscp");
+    BenchmarkClock<LfenceRdtscSource>("lfence;rdtsc");
+    BenchmarkClock<ChronoSource<TscClock>>("TscClock");
+
+    std::cout << "Invariant TSC: " << (Tsc::Invariant() ? "yes" : "no") << ", TscClock drift after 1 s: " << Tsc::DriftPpm(std::chrono::seconds{ 1 }) << " ppm\n";
+    for (auto cpu = 1UL; cpu < std::thread::hardware_concurrency(); ++cpu) {
+        const Tsc::Offset offset = Tsc::MeasureOffset(0, cpu);
+        std::cout << "TSC offset cpu " << cpu << " - cpu 0: " << offset.offsetNs << " ns, +- " << offset.roundTripNs / 2 << " ns\n";
+    }
 }
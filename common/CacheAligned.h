@@ -0,0 +1,30 @@
+#ifndef CACHE_ALIGNED_H
+#define CACHE_ALIGNED_H
+
+#include <cstddef>
+
+#include <unistd.h>
+
+// Padding for data written by one thread and sitting next to data of others
+// The destructive interference size keeps two objects off one line, the constructive one is the most that shares a line, the wrong one for padding
+namespace Cache {
+    // std::hardware_destructive_interference_size on x86, spelled out since GCC may change it with -mtune and the projects build separately
+    constexpr inline std::size_t FALSE_SHARING_SIZE = 64;
+    // The spatial prefetcher of Intel cores completes lines in 128-byte pairs, false_sharing shows whether neighbours 64 bytes apart still slow down
+    constexpr inline std::size_t PREFETCH_PAIR_SIZE = 2 * FALSE_SHARING_SIZE;
+
+    template<typename T, std::size_t ALIGN = FALSE_SHARING_SIZE>
+    struct alignas(ALIGN) Aligned {
+        T data;
+    };
+    static_assert(sizeof(Aligned<char>) == FALSE_SHARING_SIZE && alignof(Aligned<char>) == FALSE_SHARING_SIZE);
+    static_assert(sizeof(Aligned<char[FALSE_SHARING_SIZE + 1]>) == 2 * FALSE_SHARING_SIZE);
+    static_assert(sizeof(Aligned<char, PREFETCH_PAIR_SIZE>) == PREFETCH_PAIR_SIZE);
+
+    // The running cpu reports the line size the padding was compiled for
+    inline auto LineSizeMatches() -> bool { return sysconf(_SC_LEVEL1_DCACHE_LINESIZE) == static_cast<long>(FALSE_SHARING_SIZE); }
+}    // namespace Cache
+
+template<typename T, std::size_t ALIGN = Cache::FALSE_SHARING_SIZE> using CacheAligned = Cache::Aligned<T, ALIGN>;
+
+#endif
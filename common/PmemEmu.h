@@ -0,0 +1,79 @@
+#ifndef PMEM_EMU_H
+#define PMEM_EMU_H
+
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+// Pool location and persistent memory emulation, shared by the experiments that use PMDK
+// PMEM_POOL_ROOT        directory of every pool, default /mnt/pmem0/myrontsa, or /dev/shm/pmem_emu when emulating
+// PMEM_EMULATE=1        pools live on tmpfs or a regular file system, persists are charged an injected latency
+// PMEM_EMULATE_FLUSH_NS latency per flushed cache line, default 100
+// PMEM_EMULATE_FENCE_NS latency per fence, default 300
+namespace PmemEmu {
+    constexpr inline std::string_view DEFAULT_POOL_ROOT = "/mnt/pmem0/myrontsa";
+    constexpr inline std::string_view DEFAULT_EMULATED_POOL_ROOT = "/dev/shm/pmem_emu";
+    constexpr inline std::uint64_t DEFAULT_FLUSH_NS = 100;    // Roughly an Optane clwb write back
+    constexpr inline std::uint64_t DEFAULT_FENCE_NS = 300;    // Roughly an Optane sfence drain after clwb
+    constexpr inline std::uintptr_t CACHE_LINE_SIZE = 64;
+
+    struct Settings {
+        bool enabled{};
+        std::chrono::nanoseconds flushLatency{};
+        std::chrono::nanoseconds fenceLatency{};
+        std::string poolRoot{};
+    };
+
+    inline auto ReadEnv(const char* name, std::uint64_t fallback) -> std::uint64_t {
+        const char* val = std::getenv(name);
+        return val ? std::strtoull(val, nullptr, 10) : fallback;
+    }
+    inline auto Get() -> const Settings& {
+        static const Settings settings = []() {
+            Settings s{};
+            s.enabled = ReadEnv("PMEM_EMULATE", 0) != 0;
+            s.flushLatency = std::chrono::nanoseconds{ ReadEnv("PMEM_EMULATE_FLUSH_NS", DEFAULT_FLUSH_NS) };
+            s.fenceLatency = std::chrono::nanoseconds{ ReadEnv("PMEM_EMULATE_FENCE_NS", DEFAULT_FENCE_NS) };
+            const char* root = std::getenv("PMEM_POOL_ROOT");
+            s.poolRoot = root ? root : std::string{ s.enabled ? DEFAULT_EMULATED_POOL_ROOT : DEFAULT_POOL_ROOT };
+            return s;
+        }();
+        return settings;
+    }
+    inline auto Enabled() -> bool { return Get().enabled; }
+
+    // Call at the top of main, before any pool is mapped, PMDK decides pmem vs msync persists at map time
+    inline auto Init() -> void {
+        if (Enabled()) setenv("PMEM_IS_PMEM_FORCE", "1", 0);    // Persist with flush instructions instead of msync
+    }
+    // Path of pool name under the pool root, touches neither the file system nor the environment, safe in static initializers
+    inline auto PoolPath(std::string_view name) -> std::string { return (std::filesystem::path{ Get().poolRoot } / name).string(); }
+    // Creates the directory of a pool path, call where the pool is created
+    inline auto CreatePoolDir(const std::string& path) -> void { std::filesystem::create_directories(std::filesystem::path{ path }.parent_path()); }
+
+    // Busy waits, a sleep would deschedule the thread and cost far more than the injected latency
+    inline auto Delay(std::size_t lines, std::size_t fences) -> void {
+        if (!Enabled()) return;
+        const auto total = static_cast<std::int64_t>(lines) * Get().flushLatency + static_cast<std::int64_t>(fences) * Get().fenceLatency;
+        const auto deadline = std::chrono::steady_clock::now() + total;
+        while (std::chrono::steady_clock::now() < deadline) {}
+    }
+    inline auto LinesOf(const void* addr, std::size_t len) -> std::size_t {
+        const auto begin = std::bit_cast<std::uintptr_t>(addr) & ~(CACHE_LINE_SIZE - 1);
+        const auto end = std::bit_cast<std::uintptr_t>(addr) + len;
+        return (end - begin + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE;
+    }
+    // Charges the flush of every line of the range and one fence, call after the real persist
+    inline auto Persisted(const void* addr, std::size_t len) -> void { Delay(LinesOf(addr, len), 1); }
+    // pool.persist followed by the emulated latency, for pmem::obj pools
+    template<typename PoolType> auto Persist(PoolType& pool, const void* addr, std::size_t len) -> void {
+        pool.persist(addr, len);
+        Persisted(addr, len);
+    }
+}    // namespace PmemEmu
+
+#endif
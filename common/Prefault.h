@@ -0,0 +1,111 @@
+#ifndef PREFAULT_H
+#define PREFAULT_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <print>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "TscClock.h"
+
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23    // Linux 5.14, missing from older headers
+#endif
+
+// Faults a large mapping in before timing, one pinned thread per cpu, each on its own slice
+// The pools are mapped by libpmem and libpmemobj, so MAP_POPULATE is not ours to pass, madvise(MADV_POPULATE_WRITE) populates after the fact
+// Pages of tmpfs and the page cache land on the node of the thread that faults them first, pass the cpus of the socket that runs the benchmark
+namespace Prefault {
+    using Clock = TscClock;
+    constexpr inline std::size_t SLICE_ALIGN = 2UL * 1024 * 1024;    // Slices meet on 2 MB aligned addresses, no 2 MB page is faulted by two threads, DAX maps pmem with them
+
+    // Online cpus sharing the physical package of cpu, ids assumed contiguous like every PinThisThreadToCore of the repo
+    inline auto SocketCpus(std::size_t cpu) -> std::vector<std::size_t> {
+        const auto package = [](std::size_t id) {
+            std::ifstream file{ "/sys/devices/system/cpu/cpu" + std::to_string(id) + "/topology/physical_package_id" };
+            std::size_t val{};
+            file >> val;
+            return val;
+        };
+        std::vector<std::size_t> cpus{};
+        for (auto id = 0UL; id < std::jthread::hardware_concurrency(); ++id)
+            if (package(id) == package(cpu)) cpus.push_back(id);
+        return cpus;
+    }
+
+    // Every page of slice is faulted in writable, touching one byte per page where the kernel has no MADV_POPULATE_WRITE
+    inline auto Populate(std::span<std::byte> slice) -> void {
+        if (slice.empty()) return;
+        const auto pageSize = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+        const auto begin = reinterpret_cast<std::uintptr_t>(slice.data()) & ~(pageSize - 1);
+        const auto end = reinterpret_cast<std::uintptr_t>(slice.data() + slice.size());
+        if (madvise(reinterpret_cast<void*>(begin), end - begin, MADV_POPULATE_WRITE) == 0) return;
+        if (errno != EINVAL) {
+            std::println(stdout, "madvise MADV_POPULATE_WRITE Error {}", std::strerror(errno));
+            std::fflush(stdout);
+            std::abort();
+        }
+        for (auto addr = begin; addr < end; addr += pageSize) {
+            auto* byte = reinterpret_cast<volatile std::byte*>(std::max(addr, reinterpret_cast<std::uintptr_t>(slice.data())));
+            *byte = *byte;
+        }
+    }
+
+    // Splits range over cpus, each thread pinned to its cpu populates its slice then calls init(slice, offset of slice in range)
+    // Returns the wall time of the whole stage, thread start up and join included
+    template<typename Init> auto Run(std::span<std::byte> range, const std::vector<std::size_t>& cpus, Init init) -> Clock::duration {
+        const std::size_t threads = std::max(cpus.size(), 1UL);
+        // Offset in range of the first byte of slice tid, an even split rounded up to a SLICE_ALIGN boundary of the address, not of the offset
+        const auto base = reinterpret_cast<std::uintptr_t>(range.data());
+        const auto boundary = [base, size = range.size(), threads](std::size_t tid) -> std::size_t {
+            if (tid == 0) return 0;
+            if (tid == threads) return size;
+            const std::uintptr_t aligned = (base + size / threads * tid + SLICE_ALIGN - 1) / SLICE_ALIGN * SLICE_ALIGN;
+            return std::min(aligned - base, size);
+        };
+        const auto begin = Clock::now();
+        {
+            std::vector<std::jthread> workers{};
+            for (auto tid = 0UL; tid < threads; ++tid) {
+                const std::size_t offset = boundary(tid);
+                const auto slice = range.subspan(offset, boundary(tid + 1) - offset);
+                if (slice.empty()) continue;
+                workers.emplace_back([&cpus, &init, tid, offset, slice] {
+                    if (!cpus.empty()) {
+                        cpu_set_t cpu_mask;
+                        CPU_ZERO(&cpu_mask);
+                        CPU_SET(cpus[tid], &cpu_mask);
+                        // An unpinned thread would fault its slice on whatever node it runs on
+                        if (const int err = pthread_setaffinity_np(pthread_self(), sizeof(cpu_mask), &cpu_mask); err != 0) {
+                            std::println(stdout, "Prefault pthread_setaffinity_np cpu {} Error {}", cpus[tid], std::strerror(err));
+                            std::fflush(stdout);
+                            std::abort();
+                        }
+                    }
+                    Populate(slice);
+                    init(slice, offset);
+                });
+            }
+        }
+        return Clock::now() - begin;
+    }
+    // Populate only, contents left as they are
+    inline auto Run(std::span<std::byte> range, const std::vector<std::size_t>& cpus) -> Clock::duration {
+        return Run(range, cpus, [](std::span<std::byte>, std::size_t) {});
+    }
+}    // namespace Prefault
+
+#endif
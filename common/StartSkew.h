@@ -0,0 +1,60 @@
+#ifndef START_SKEW_H
+#define START_SKEW_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <immintrin.h>
+#include <x86intrin.h>
+
+#include "CacheAligned.h"
+#include "TscClock.h"
+
+// How late each thread of a team really starts after tid 0 takes begin, and a deadline start that does not depend on barrier wake up
+// Wake times are TSC reads, comparable across cores on cpus with an invariant TSC
+namespace StartSkew {
+    using Clock = TscClock;
+    constexpr inline Clock::duration DEADLINE_SLACK = std::chrono::microseconds{ 500 };    // Time for every woken thread to reach its spin
+
+    inline auto ReadTsc() -> std::uint64_t {
+        unsigned int aux{};
+        return __rdtscp(&aux);
+    }
+
+    // Deadline start: every thread spins to the same absolute time instead of waking from the barrier, begin is the deadline
+    inline auto Deadline() -> Clock::time_point { return Clock::now() + DEADLINE_SLACK; }
+    inline auto SpinUntil(Clock::time_point deadline) -> void {
+        while (Clock::now() < deadline) _mm_pause();
+    }
+
+    struct Summary {
+        double maxLateNs{};     // Latest thread after tid 0
+        double meanLateNs{};    // Mean over the other threads
+        double spreadNs{};      // Latest minus earliest thread
+    };
+
+    // Each thread records its wake right after the start barrier or deadline, tid 0 next to taking begin
+    class Recorder {
+    public:
+        explicit Recorder(std::size_t threads)
+            : wakes(threads) {}
+        auto Record(std::size_t tid) -> void { wakes[tid].data = ReadTsc(); }
+        auto Summarize() const -> Summary {
+            const auto late = [this](const Wake& wake) { return static_cast<double>(static_cast<std::int64_t>(wake.data - wakes.front().data)) / Tsc::TicksPerNs(); };
+            const auto [earliest, latest] = std::ranges::minmax_element(wakes, {}, &Wake::data);
+            Summary summary{ .maxLateNs = late(*latest), .spreadNs = late(*latest) - late(*earliest) };
+            for (const auto& wake : wakes) summary.meanLateNs += late(wake);
+            if (wakes.size() > 1) summary.meanLateNs /= static_cast<double>(wakes.size() - 1);
+            return summary;
+        }
+
+    private:
+        using Wake = CacheAligned<std::uint64_t>;
+        std::vector<Wake> wakes{};
+    };
+}    // namespace StartSkew
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef TSC_CLOCK_H
+#define TSC_CLOCK_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <limits>
+#include <thread>
+
+#include <cpuid.h>
+#include <pthread.h>
+#include <x86intrin.h>
+
+// std::chrono clock over the TSC, a few cycles per now() where the vDSO clock_gettime takes ~20 ns
+// Calibrated once at startup against CLOCK_MONOTONIC_RAW, its time points share that epoch
+// Needs an invariant TSC, synchronized across cores, check with Tsc::Invariant and Tsc::MeasureOffset
+namespace Tsc {
+    constexpr inline std::chrono::milliseconds CALIBRATION_INTERVAL{ 20 };
+    constexpr inline std::size_t BRACKET_SAMPLES = 64;    // Reads of MONOTONIC_RAW, the tightest bracketed by two TSC reads wins
+
+    // CPUID.80000007H:EDX[8], the TSC ticks at a constant rate through frequency and C-state changes
+    inline auto Invariant() -> bool {
+        unsigned int eax{}, ebx{}, ecx{}, edx{};
+        if (__get_cpuid_max(0x80000000, nullptr) < 0x80000007) return false;
+        __cpuid(0x80000007, eax, ebx, ecx, edx);
+        return (edx & (1U << 8)) != 0;
+    }
+
+    inline auto RawNs() -> std::int64_t {
+        struct timespec tm {};
+        clock_gettime(CLOCK_MONOTONIC_RAW, &tm);
+        return tm.tv_sec * 1'000'000'000 + tm.tv_nsec;
+    }
+    struct Sample {
+        std::uint64_t tsc{};
+        std::int64_t ns{};
+    };
+    // MONOTONIC_RAW paired with the TSC read in the middle of the shortest bracket
+    inline auto PairedSample() -> Sample {
+        Sample best{};
+        std::uint64_t bestWidth = std::numeric_limits<std::uint64_t>::max();
+        for (auto i = 0UL; i < BRACKET_SAMPLES; ++i) {
+            const std::uint64_t before = __rdtsc();
+            const std::int64_t ns = RawNs();
+            const std::uint64_t after = __rdtsc();
+            if (after - before < bestWidth) {
+                bestWidth = after - before;
+                best = { before + (after - before) / 2, ns };
+            }
+        }
+        return best;
+    }
+
+    struct Calibration {
+        Sample base{};
+        double ticksPerNs{};
+        double nsPerTick{};
+    };
+    inline auto Calibrate(std::chrono::nanoseconds interval) -> Calibration {
+        const Sample begin = PairedSample();
+        while (RawNs() - begin.ns < interval.count()) _mm_pause();
+        const Sample end = PairedSample();
+        const double ticksPerNs = static_cast<double>(end.tsc - begin.tsc) / static_cast<double>(end.ns - begin.ns);
+        return { begin, ticksPerNs, 1.0 / ticksPerNs };
+    }
+    inline const Calibration CALIBRATION = []() {
+        if (!Invariant()) std::fputs("TscClock: no invariant TSC, timings may drift with frequency changes\n", stderr);
+        return Calibrate(CALIBRATION_INTERVAL);
+    }();
+    inline auto TicksPerNs() -> double { return CALIBRATION.ticksPerNs; }
+
+    class Clock {
+    public:
+        using rep = std::int64_t;
+        using period = std::nano;
+        using duration = std::chrono::duration<rep, period>;
+        using time_point = std::chrono::time_point<Clock>;
+        static constexpr bool is_steady = true;
+        // rdtsc is not ordered against surrounding loads, wrap it with lfence where that matters more than the cycles
+        static auto now() noexcept -> time_point {
+            const auto ticks = static_cast<double>(static_cast<std::int64_t>(__rdtsc() - CALIBRATION.base.tsc));
+            return time_point{ duration{ CALIBRATION.base.ns + static_cast<rep>(ticks * CALIBRATION.nsPerTick) } };
+        }
+    };
+
+    // Parts per million the TSC rate moved from the startup calibration, recalibrating over interval
+    inline auto DriftPpm(std::chrono::nanoseconds interval) -> double { return (Calibrate(interval).ticksPerNs / TicksPerNs() - 1.0) * 1e6; }
+
+    struct Offset {
+        double offsetNs{};       // TSC of cpuB minus TSC of cpuA
+        double roundTripNs{};    // Of the ping-pong the estimate came from, the offset is known to within half of it
+    };
+    // Ping-pong between threads pinned to cpuA and cpuB, cpuB's TSC is compared to the midpoint of the shortest round trip
+    inline auto MeasureOffset(std::size_t cpuA, std::size_t cpuB, std::uint64_t rounds = 10'000) -> Offset {
+        const auto pin = [](std::size_t cpu) {
+            cpu_set_t cpu_mask;
+            CPU_ZERO(&cpu_mask);
+            CPU_SET(cpu % std::thread::hardware_concurrency(), &cpu_mask);
+            pthread_setaffinity_np(pthread_self(), sizeof(cpu_mask), &cpu_mask);
+        };
+        std::atomic<std::uint64_t> ping{}, pong{}, remoteTsc{};
+        std::uint64_t bestRoundTrip = std::numeric_limits<std::uint64_t>::max();
+        std::int64_t bestOffset{};
+        std::jthread remote{ [&, cpuB]() {
+            pin(cpuB);
+            for (std::uint64_t i = 1; i <= rounds; ++i) {
+                while (ping.load(std::memory_order_acquire) != i) _mm_pause();
+                remoteTsc.store(__rdtsc(), std::memory_order_relaxed);
+                pong.store(i, std::memory_order_release);
+            }
+        } };
+        std::jthread local{ [&, cpuA]() {
+            pin(cpuA);
+            for (std::uint64_t i = 1; i <= rounds; ++i) {
+                const std::uint64_t sent = __rdtsc();
+                ping.store(i, std::memory_order_release);
+                while (pong.load(std::memory_order_acquire) != i) _mm_pause();
+                const std::uint64_t received = __rdtsc();
+                if (received - sent < bestRoundTrip) {
+                    bestRoundTrip = received - sent;
+                    bestOffset = static_cast<std::int64_t>(remoteTsc.load(std::memory_order_relaxed) - (sent + bestRoundTrip / 2));
+                }
+            }
+        } };
+        local.join();
+        remote.join();
+        return { static_cast<double>(bestOffset) / TicksPerNs(), static_cast<double>(bestRoundTrip) / TicksPerNs() };
+    }
+}    // namespace Tsc
+
+using TscClock = Tsc::Clock;
+
+#endif
@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <barrier>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <sched.h>
+#include <sys/rseq.h>
+#include <unistd.h>
+
+#include "CacheAligned.h"
+#include "TscClock.h"
+
+#ifndef PARAM_N_THREADS
+#define PARAM_N_THREADS 24
+#endif
+#ifndef PARAM_COUNTER
+#define PARAM_COUNTER Atomic
+#endif
+
+namespace {
+    auto consteval Pow(std::size_t base, std::size_t exp) -> std::size_t { return exp == 0 ? 1 : base * Pow(base, exp - 1); }
+
+    constexpr std::size_t N_THREADS = PARAM_N_THREADS;
+    constexpr std::size_t LOG2N_OPS = 25;
+    constexpr std::size_t NOps = Pow(2, LOG2N_OPS);
+    constexpr std::size_t ThreadOps = NOps / N_THREADS;
+    constexpr std::uint64_t READ_BATCH = 64;    // Reads between checks of the stop flag
+    constexpr std::uint64_t APPROXIMATE_BATCH = 1024;    // Local increments per shared fetch_add, a read may miss N_THREADS * APPROXIMATE_BATCH
+
+    auto PinThisThreadToCore(std::size_t core) -> void {
+        int err{};
+        err = pthread_setconcurrency(static_cast<int>(std::thread::hardware_concurrency()));
+        if (err != 0) throw std::runtime_error{ "pthread_setconcurrency" };
+        cpu_set_t cpu_mask;
+        CPU_ZERO(&cpu_mask);
+        CPU_SET(core, &cpu_mask);
+        err = pthread_setaffinity_np(pthread_self(), sizeof(cpu_mask), &cpu_mask);
+        if (err != 0) throw std::runtime_error{ "pthread_setaffinity_np" };
+    }
+
+    // cpu of the calling thread from the rseq area glibc registers, one load, sched_getcpu where rseq is unavailable
+    auto CurrentCpu() -> std::size_t {
+        if (__rseq_size > 0) {
+            const auto* rs = static_cast<const struct rseq*>(static_cast<void*>(static_cast<char*>(__builtin_thread_pointer()) + __rseq_offset));
+            return static_cast<std::size_t>(__atomic_load_n(&rs->cpu_id, __ATOMIC_RELAXED));
+        }
+        return static_cast<std::size_t>(sched_getcpu());
+    }
+
+    // Every increment is a read-modify-write of one shared line
+    class Atomic {
+    private:
+        std::atomic<std::uint64_t> value{};
+
+    public:
+        auto Increment([[maybe_unused]] std::size_t tid) -> void { value.fetch_add(1, std::memory_order_relaxed); }
+        auto Flush([[maybe_unused]] std::size_t tid) -> void {}
+        auto Read() const -> std::uint64_t { return value.load(std::memory_order_relaxed); }
+    };
+
+    // One line per thread, a single writer increments with a plain load and store, readers sum every line
+    class PerThread {
+    private:
+        std::array<CacheAligned<std::atomic<std::uint64_t>>, N_THREADS> slots{};
+
+    public:
+        auto Increment(std::size_t tid) -> void {
+            auto& slot = slots.at(tid).data;
+            slot.store(slot.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        auto Flush([[maybe_unused]] std::size_t tid) -> void {}
+        auto Read() const -> std::uint64_t {
+            std::uint64_t sum{};
+            for (const auto& slot : slots) sum += slot.data.load(std::memory_order_relaxed);
+            return sum;
+        }
+    };
+
+    // One line per cpu, threads may migrate or share a cpu so increments stay atomic, uncontended while threads are pinned
+    class PerCpu {
+    private:
+        std::vector<CacheAligned<std::atomic<std::uint64_t>>> slots = std::vector<CacheAligned<std::atomic<std::uint64_t>>>(static_cast<std::size_t>(sysconf(_SC_NPROCESSORS_CONF)));
+
+    public:
+        auto Increment([[maybe_unused]] std::size_t tid) -> void { slots[CurrentCpu()].data.fetch_add(1, std::memory_order_relaxed); }
+        auto Flush([[maybe_unused]] std::size_t tid) -> void {}
+        auto Read() const -> std::uint64_t {
+            std::uint64_t sum{};
+            for (const auto& slot : slots) sum += slot.data.load(std::memory_order_relaxed);
+            return sum;
+        }
+    };
+
+    // Sloppy counter, threads count locally and publish every APPROXIMATE_BATCH increments, reads are one load but lag behind
+    class Approximate {
+    private:
+        std::atomic<std::uint64_t> value{};
+        std::array<CacheAligned<std::uint64_t>, N_THREADS> locals{};
+
+    public:
+        auto Increment(std::size_t tid) -> void {
+            auto& local = locals.at(tid).data;
+            if (++local < APPROXIMATE_BATCH) return;
+            value.fetch_add(local, std::memory_order_relaxed);
+            local = 0;
+        }
+        auto Flush(std::size_t tid) -> void {
+            value.fetch_add(locals.at(tid).data, std::memory_order_relaxed);
+            locals.at(tid).data = 0;
+        }
+        auto Read() const -> std::uint64_t { return value.load(std::memory_order_relaxed); }
+    };
+
+    using Clock = TscClock;
+    using TimePoint = Clock::time_point;
+
+    struct Reads {
+        std::uint64_t count{};
+        Clock::duration duration{};
+    };
+
+    // Every thread increments ThreadOps times, the reader, when given a cpu, reads the counter until the last increment thread finishes
+    template<typename Counter> auto RunIncrements(Counter* counter, std::optional<std::size_t> readerCpu, Reads& reads) -> Clock::duration {
+        const std::size_t readers = readerCpu ? 1 : 0;
+        std::array<std::thread, N_THREADS> threads{};
+        TimePoint begin{};
+        TimePoint end{};
+        std::barrier startBarrier{ static_cast<std::ptrdiff_t>(N_THREADS + readers) };    // The reader starts with the increment threads
+        std::barrier clockBarrier{ N_THREADS };
+        std::atomic<std::size_t> writing{ N_THREADS };    // Increment threads still running, the reader stops at 0
+
+        std::thread reader{};
+        if (readerCpu) {
+            reader = std::thread{ [counter, cpu = *readerCpu, &reads, &startBarrier, &writing]() {
+                PinThisThreadToCore(cpu);
+                std::uint64_t sink{};
+                startBarrier.arrive_and_wait();
+                const TimePoint readBegin = Clock::now();
+                while (writing.load(std::memory_order_relaxed) != 0) {
+                    for (auto i = 0UL; i < READ_BATCH; ++i) {
+                        sink += counter->Read();
+                        asm volatile("" : : "r,m"(sink) : "memory");
+                    }
+                    reads.count += READ_BATCH;
+                }
+                reads.duration = Clock::now() - readBegin;
+            } };
+        }
+        for (auto tid = 0UL; tid < threads.size(); ++tid) {
+            threads.at(tid) = std::thread([tid, counter, &begin, &end, &startBarrier, &clockBarrier, &writing]() {
+                PinThisThreadToCore(tid % N_THREADS);
+                startBarrier.arrive_and_wait();
+                if (tid == 0) begin = Clock::now();
+                for (auto i = 0UL; i < ThreadOps; ++i) counter->Increment(tid);
+                writing.fetch_sub(1, std::memory_order_relaxed);
+                clockBarrier.arrive_and_wait();
+                if (tid == 0) end = Clock::now();
+            });
+        }
+        for (auto& t : threads) t.join();
+        if (reader.joinable()) reader.join();
+        return end - begin;
+    }
+
+    template<typename Counter> auto Benchmark() -> void {
+        using Unit = std::chrono::milliseconds;
+
+        // Increments alone, the throughput RunAll.py reports
+        const auto counter = std::make_unique<Counter>();
+        Reads none{};
+        const Clock::duration duration = RunIncrements(counter.get(), std::nullopt, none);
+        const std::uint64_t observed = counter->Read();
+        for (auto tid = 0UL; tid < N_THREADS; ++tid) counter->Flush(tid);
+        assert(counter->Read() == ThreadOps * N_THREADS);
+
+        // A second run on a fresh counter with a reader on cpu N_THREADS, the cost a metrics scrape pays per counter under load
+        // Without a spare cpu the reader would time share with an increment thread, the read phase is skipped and read ns is nan
+        const bool spareCpu = N_THREADS < std::thread::hardware_concurrency();
+        Reads reads{};
+        Clock::duration loadedDuration{};
+        if (spareCpu) {
+            const auto loaded = std::make_unique<Counter>();
+            loadedDuration = RunIncrements(loaded.get(), N_THREADS, reads);
+        }
+        const double readNs = spareCpu ? std::chrono::duration<double, std::nano>(reads.duration).count() / static_cast<double>(std::max(reads.count, READ_BATCH))
+                                       : std::numeric_limits<double>::quiet_NaN();
+
+        // RunAll.py parses duration, operations and read ns, the last line is for reading
+        std::cout << std::chrono::duration_cast<Unit>(duration).count() << "\n"
+                  << NOps << "\n"
+                  << readNs << "\n";
+        if (spareCpu)
+            std::cout << reads.count << " reads, increments took " << std::chrono::duration_cast<Unit>(loadedDuration).count() << " ms under the reader, ";
+        else
+            std::cout << "no cpu left for the reader past the " << N_THREADS << " increment threads, read phase skipped, ";
+        std::cout << "observed " << observed << " of " << ThreadOps * N_THREADS << " increments before the flush\n";
+    }
+}    // namespace
+
+auto main() -> int {
+    Benchmark<PARAM_COUNTER>();
+}
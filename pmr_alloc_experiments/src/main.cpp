@@ -8,6 +8,9 @@
 #include <thread>
 
 #include <jemalloc/jemalloc.h>
+#include "CacheAligned.h"
+#include "StartSkew.h"
+#include "TscClock.h"
 #include "synch_pool.h"
 
 #ifndef PARAM_N_THREADS
@@ -25,6 +28,9 @@
 #ifndef PARAM_ENABLE_DEALLOCATE
 #define PARAM_ENABLE_DEALLOCATE false
 #endif
+#ifndef PARAM_START_MODE
+#define PARAM_START_MODE Barrier
+#endif
 
 namespace {
     auto consteval Pow(std::size_t base, std::size_t exp) -> std::size_t { return exp == 0 ? 1 : base * Pow(base, exp - 1); }
@@ -33,17 +39,16 @@ namespace {
     constexpr std::size_t N_THREADS = PARAM_N_THREADS;
     constexpr auto ALLOC_SIZES = std::to_array<std::size_t>(PARAM_ALLOC_SIZES);
     constexpr bool ENABLE_DEALLOCATE = PARAM_ENABLE_DEALLOCATE;
+    enum class StartMode {
+        Barrier,     // tid 0 takes begin when it leaves the start barrier
+        Deadline,    // every thread spins to an absolute start time set by the start barrier, begin is the deadline
+    };
+    constexpr StartMode START_MODE = StartMode::PARAM_START_MODE;
     constexpr std::size_t LOG2N_OPS = 24;
 
     constexpr std::size_t MAX_BLOCKS_PER_CHUNK = Pow(2, LOG2N_OPS + 1);
     constexpr std::size_t MBR_SIZE = Sum(ALLOC_SIZES) * MAX_BLOCKS_PER_CHUNK;
 
-#ifdef __cpp_lib_hardware_interference_size
-    constexpr std::size_t CACHE_LINE_SIZE = std::hardware_constructive_interference_size;
-#else
-    constexpr std::size_t CACHE_LINE_SIZE = 64;
-#endif
-
     // auto& DStream = std::cout;
     auto DStream = std::ofstream{ "/dev/null", std::ios_base::app };
 
@@ -58,9 +63,6 @@ namespace {
         if (err != 0) throw std::runtime_error{ "pthread_setaffinity_np" };
     }
 
-    template<typename T>
-    struct alignas(CACHE_LINE_SIZE) Aligned { T data; };
-
     class NewDelete {
     private:
         std::pmr::polymorphic_allocator<> allocator{ std::pmr::new_delete_resource() };
@@ -137,7 +139,7 @@ namespace {
             std::pmr::monotonic_buffer_resource mbr{ buffer.data(), buffer.size() * sizeof(std::byte), std::pmr::null_memory_resource() };
             std::pmr::polymorphic_allocator<> allocator{ &mbr };
         };
-        std::array<Aligned<Arena>, N_THREADS> arenas;
+        std::array<CacheAligned<Arena>, N_THREADS> arenas;
 
     public:
         ArenaBuffer() {
@@ -158,7 +160,7 @@ namespace {
             std::pmr::unsynchronized_pool_resource pool{ { .max_blocks_per_chunk = MAX_BLOCKS_PER_CHUNK / N_THREADS }, std::pmr::new_delete_resource() };
             std::pmr::polymorphic_allocator<> allocator{ &pool };
         };
-        std::array<Aligned<Arena>, N_THREADS> arenas;
+        std::array<CacheAligned<Arena>, N_THREADS> arenas;
 
     public:
         ArenaPoolHeap() {
@@ -181,7 +183,7 @@ namespace {
             std::pmr::unsynchronized_pool_resource pool{ { .max_blocks_per_chunk = MAX_BLOCKS_PER_CHUNK / N_THREADS }, &mbr };
             std::pmr::polymorphic_allocator<> allocator{ &pool };
         };
-        std::array<Aligned<Arena>, N_THREADS> arenas;
+        std::array<CacheAligned<Arena>, N_THREADS> arenas;
 
     public:
         ArenaPoolBuffer() {
@@ -212,7 +214,7 @@ namespace {
         struct Arena {
             std::array<SynchPoolStruct, ALLOC_SIZES.size()> synchPools{};
         };
-        std::array<Aligned<Arena>, N_THREADS> arenas;
+        std::array<CacheAligned<Arena>, N_THREADS> arenas;
 
         static auto Idx(std::size_t val) -> std::size_t {
             for (auto i = 0U; i < ALLOC_SIZES.size(); ++i)
@@ -248,7 +250,7 @@ namespace {
         };
     };
     auto Benchmark(auto* allocator) -> void {
-        using Clock = std::chrono::steady_clock;
+        using Clock = TscClock;
         using Unit = std::chrono::milliseconds;
         using TimePoint = Clock::time_point;
         constexpr std::size_t NOps = Pow(2, LOG2N_OPS);
@@ -257,12 +259,23 @@ namespace {
         TimePoint begin{};
         TimePoint end{};
         std::barrier clockBarrier{ N_THREADS };
+        TimePoint deadline{};
+        std::barrier startBarrier{ N_THREADS, [&deadline]() noexcept { deadline = StartSkew::Deadline(); } };
+        StartSkew::Recorder wakes{ N_THREADS };
 
         for (auto tid = 0U; tid < threads.size(); ++tid) {
-            threads.at(tid) = std::thread([tid, allocator, &begin, &end, &clockBarrier]() {
+            threads.at(tid) = std::thread([tid, allocator, &begin, &end, &clockBarrier, &deadline, &startBarrier, &wakes]() {
                 PinThisThreadToCore(tid % N_THREADS);
-                clockBarrier.arrive_and_wait();
-                if (tid == 0) begin = Clock::now();
+                if constexpr (START_MODE == StartMode::Deadline) {
+                    startBarrier.arrive_and_wait();
+                    StartSkew::SpinUntil(deadline);
+                    wakes.Record(tid);
+                    if (tid == 0) begin = deadline;
+                } else {
+                    clockBarrier.arrive_and_wait();
+                    wakes.Record(tid);
+                    if (tid == 0) begin = Clock::now();
+                }
                 for (auto i = 0U; i < threadOps; ++i) {
                     const auto allocSize = ALLOC_SIZES.at(i % ALLOC_SIZES.size());
                     void* p = allocator->AllocateBytes(allocSize, tid);
@@ -275,8 +288,13 @@ namespace {
             });
         }
         for (auto& t : threads) t.join();
+        // Lines after the first two are for reading, RunAll.py parses duration and operations only
+        const StartSkew::Summary skew = wakes.Summarize();
+        const auto durationNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
         std::cout << std::chrono::duration_cast<Unit>(end - begin).count() << "\n"
-                  << NOps << "\n";
+                  << NOps << "\n"
+                  << "wake skew: max " << skew.maxLateNs << " ns, mean " << skew.meanLateNs << " ns, spread " << skew.spreadNs << " ns, max "
+                  << 100.0 * skew.maxLateNs / durationNs << "% of the run\n";
     }
 }    // namespace
 
@@ -1,5 +1,7 @@
 #include "synch_pool.h"
 
+#include "CacheAligned.h"
+
 #include <malloc.h>
 #include <numa.h>
 
@@ -13,11 +15,7 @@ static const uint32_t BLOCK_SIZE = 4096 * 8192;
 
 #define POOL_BLOCK_METADATA_SIZE sizeof(SynchPoolBlockMetadata)
 
-#ifdef __cpp_lib_hardware_interference_size
-constexpr std::size_t CACHE_LINE_SIZE = std::hardware_constructive_interference_size;
-#else
-constexpr std::size_t CACHE_LINE_SIZE = 64;
-#endif
+constexpr std::size_t CACHE_LINE_SIZE = Cache::FALSE_SHARING_SIZE;    // Blocks of different threads never share a line
 
 static inline void* synchGetAlignedMemory(size_t align, size_t size) {
     void* p;